@@ -0,0 +1,53 @@
+/*
+ * attitude.h
+ *
+ * Mahony complementary filter on the LSM6DS33, run on every IMU sample
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_ATTITUDE_H_
+#define INC_ATTITUDE_H_
+
+#include <stdint.h>
+
+//Default gains. kp sets how fast the accelerometer pulls roll/pitch [rad/s per rad],
+//ki lets the filter absorb the gyro bias on the roll/pitch axes
+#define ATT_KP					2.0f
+#define ATT_KI					0.05f
+
+//Samples further apart than this are treated as a restart of the stream [s]
+#define ATT_MAX_DT				0.01f
+
+typedef struct{
+	float q0, q1, q2, q3;	/*!< Body to world quaternion >*/
+	float integral[3];		/*!< Integral of the accelerometer error [rad/s] >*/
+	float kp;				/*!< Proportional gain >*/
+	float ki;				/*!< Integral gain >*/
+	float roll;				/*!< [rad] >*/
+	float pitch;			/*!< [rad] >*/
+	float yaw_rate;			/*!< Rate about the world vertical, bias corrected [rad/s] >*/
+	uint32_t stamp;			/*!< Sample time of the last update [us] >*/
+	uint8_t initialised;
+}attitude_t;
+
+extern attitude_t attitude;
+
+/**
+ * \brief Reset the filter, the first sample levels it from the accelerometer
+ * \param [in]      att pointer to attitude struct
+ * \param [in]      kp proportional gain
+ * \param [in]      ki integral gain
+ */
+void ATT_Init(attitude_t* att, float kp, float ki);
+
+/**
+ * \brief Propagate the filter with one IMU sample
+ * \param [in]      att pointer to attitude struct
+ * \param [in]      gyro angular rate [rad/s]
+ * \param [in]      acc acceleration, any unit
+ * \param [in]      stamp sample time [us]
+ */
+void ATT_Update(attitude_t* att, const float* gyro, const float* acc, uint32_t stamp);
+
+#endif /* INC_ATTITUDE_H_ */
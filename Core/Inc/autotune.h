@@ -0,0 +1,114 @@
+/*
+ * autotune.h
+ *
+ * Relay feedback (Astrom-Hagglund) autotuning of a wheel velocity loop. The relay drives
+ * the wheel into a limit cycle around the setpoint, its amplitude and period give the
+ * ultimate gain and period. Run with the chair lifted or on rollers
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_AUTOTUNE_H_
+#define INC_AUTOTUNE_H_
+
+#include <stdint.h>
+
+//Packet tag sent with USB_Transmit_Cargo: tag, wheel, then ku, tu, p, i, d as little endian floats
+#define AT_TAG_RESULT			0x54
+
+#define AT_GAINS_VERSION		1
+
+typedef enum{
+	AT_IDLE,
+	AT_RUNNING,
+	AT_DONE,
+	AT_FAILED				/*!< No stable limit cycle before the timeout >*/
+}atState;
+
+typedef enum{
+	AT_RULE_ZN_PI,			/*!< Ziegler-Nichols PI >*/
+	AT_RULE_ZN_PID,			/*!< Ziegler-Nichols PID >*/
+	AT_RULE_TYREUS_LUYBEN	/*!< Tyreus-Luyben PI, less overshoot and more phase margin >*/
+}atRule;
+
+typedef struct{
+	float setpoint;			/*!< Wheel velocity the limit cycle is centred on [m/s] >*/
+	float bias;				/*!< Command that holds the setpoint, e.g. from the feedforward >*/
+	float amplitude;		/*!< Relay step added to and subtracted from the bias >*/
+	float hysteresis;		/*!< Error band before the relay switches [m/s] >*/
+	uint8_t discard_cycles;	/*!< Cycles ignored while the oscillation builds up >*/
+	uint8_t measure_cycles;	/*!< Cycles averaged for the result >*/
+	uint32_t timeout;		/*!< Give up after this long [ms] >*/
+}atConfig;
+
+typedef struct{
+	atConfig cfg;
+	atState state;
+	int8_t relay;			/*!< Current relay output, +1 or -1 >*/
+	uint32_t start;			/*!< HAL tick the run started >*/
+	uint32_t last_rise;		/*!< HAL tick of the last switch to +1 >*/
+	uint8_t cycles;			/*!< Complete cycles seen >*/
+	float y_max;			/*!< Peaks of the current cycle >*/
+	float y_min;
+	float period_sum;		/*!< Sums over the measured cycles >*/
+	float amp_sum;
+	float ku;				/*!< Ultimate gain >*/
+	float tu;				/*!< Ultimate period [s] >*/
+	float p, i, d;			/*!< Gains in PID_setPID form >*/
+}autotune_t;
+
+typedef struct{
+	uint32_t version;
+	uint32_t controller;	/*!< FF_BY or FF_CX, gains are only valid for the regime they were tuned in >*/
+	float p[2], i[2], d[2];
+}wheelGains;
+
+/**
+ * \brief Start a relay experiment
+ * \param [in]      at pointer to autotune struct
+ * \param [in]      cfg experiment configuration, copied
+ * \param [in]      tick current HAL tick [ms]
+ */
+void AT_Start(autotune_t* at, const atConfig* cfg, uint32_t tick);
+
+/**
+ * \brief Run the relay for one sample
+ * \param [in]      at pointer to autotune struct
+ * \param [in]      y measured wheel velocity [m/s]
+ * \param [in]      tick current HAL tick [ms]
+ * \return Command to apply, the bias once the run has finished
+ */
+float AT_Step(autotune_t* at, float y, uint32_t tick);
+
+/**
+ * \brief Compute PID gains from the ultimate gain and period
+ * \param [in]      at pointer to autotune struct, must be AT_DONE
+ * \param [in]      rule tuning rule
+ */
+void AT_Compute(autotune_t* at, atRule rule);
+
+/**
+ * \brief Send the result of a wheel over USB
+ * \param [in]      at pointer to autotune struct
+ * \param [in]      wheel LEFT_INDEX or RIGHT_INDEX
+ * \return USBD_OK if the endpoint took it, call again on the next tick otherwise
+ */
+uint8_t AT_Report(const autotune_t* at, uint8_t wheel);
+
+/**
+ * \brief Store the gains of both wheels in flash. Stalls the CPU, see PARAM_Save
+ * \param [in]      at autotune results of both wheels
+ * \param [in]      controller FF_BY or FF_CX
+ * \return 1 on success
+ */
+uint8_t AT_Save(const autotune_t* at, uint8_t controller);
+
+/**
+ * \brief Load stored gains
+ * \param [out]     gains stored gains
+ * \param [in]      controller FF_BY or FF_CX
+ * \return 1 if gains tuned for this controller were found
+ */
+uint8_t AT_Load(wheelGains* gains, uint8_t controller);
+
+#endif /* INC_AUTOTUNE_H_ */
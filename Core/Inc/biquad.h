@@ -0,0 +1,88 @@
+/*
+ * biquad.h
+ *
+ * Cascaded biquad filters in direct form I. The instance layout and coefficient order match
+ * CMSIS-DSP arm_biquad_casd_df1_inst_f32, so BQ_Process can hand over to
+ * arm_biquad_cascade_df1_f32 when the DSP library is linked (define ARM_MATH_CM4)
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_BIQUAD_H_
+#define INC_BIQUAD_H_
+
+#include <stdint.h>
+
+#define BIQUAD_MAX_STAGES		4
+
+typedef enum{
+	BQ_PASS,
+	BQ_LOWPASS,
+	BQ_NOTCH
+}biquadType;
+
+//Same layout as arm_biquad_casd_df1_inst_f32
+typedef struct{
+	uint32_t num_stages;
+	float* state;			/*!< 4 per stage: x[n-1], x[n-2], y[n-1], y[n-2] >*/
+	const float* coeffs;	/*!< 5 per stage: b0, b1, b2, a1, a2 with a1, a2 negated >*/
+}biquadCascade;
+
+typedef struct{
+	biquadCascade inst;
+	float coeffs[5 * BIQUAD_MAX_STAGES];
+	float state[4 * BIQUAD_MAX_STAGES];
+}biquadFilter;
+
+/**
+ * \brief Set up a cascade with every stage passing the input through
+ * \param [in]      filter pointer to filter struct
+ * \param [in]      num_stages number of biquads, at most BIQUAD_MAX_STAGES
+ */
+void BQ_Init(biquadFilter* filter, uint8_t num_stages);
+
+/**
+ * \brief Design one stage (RBJ cookbook). Can be called at runtime, the state is kept
+ * \param [in]      filter pointer to filter struct
+ * \param [in]      stage stage index
+ * \param [in]      type filter type
+ * \param [in]      fs sample rate [Hz]
+ * \param [in]      f0 cutoff or notch frequency [Hz]
+ * \param [in]      q quality factor, 0.7071 for a Butterworth low pass
+ */
+void BQ_Configure(biquadFilter* filter, uint8_t stage, biquadType type, float fs, float f0, float q);
+
+/**
+ * \brief Preload the state as if the input had been constant, avoids the start up transient
+ * \param [in]      filter pointer to filter struct
+ * \param [in]      value input value
+ */
+void BQ_Reset(biquadFilter* filter, float value);
+
+/**
+ * \brief Filter a block of samples, in and out may be the same buffer
+ * \param [in]      filter pointer to filter struct
+ * \param [in]      in input samples
+ * \param [out]     out output samples
+ * \param [in]      block_size number of samples
+ */
+void BQ_Process(biquadFilter* filter, const float* in, float* out, uint32_t block_size);
+
+/**
+ * \brief Filter a single sample
+ * \param [in]      filter pointer to filter struct
+ * \param [in]      in input sample
+ * \return Filtered sample
+ */
+float BQ_Step(biquadFilter* filter, float in);
+
+/**
+ * \brief Measure BQ_Process with the DWT cycle counter. DWT_Init must have been called
+ * \param [in]      filter filter to run, its state is disturbed
+ * \param [in]      buf scratch buffer
+ * \param [in]      block_size samples per call
+ * \return Cycles per sample
+ */
+float BQ_Benchmark(biquadFilter* filter, float* buf, uint32_t block_size);
+
+#endif /* INC_BIQUAD_H_ */
@@ -0,0 +1,80 @@
+/*
+ * clock_profile.h
+ *
+ * Clock tree profiles. A profile sets the PLL, the regulator scale (and over-drive), the flash wait
+ * states, the bus prescalers and the ART accelerator in one go. Peripheral init asks this module for
+ * timer and SPI prescalers instead of hard coding them, so they keep their rates on every profile.
+ * The UART baud registers are computed by HAL_UART_Init from the bus clock already
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_CLOCK_PROFILE_H_
+#define INC_CLOCK_PROFILE_H_
+
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+
+typedef enum{
+	CLK_PROFILE_LOW_POWER = 0,	//72MHz, scale 3, prefetch off. The clock tree the board was brought up with
+	CLK_PROFILE_PERFORMANCE,	//168MHz, scale 1, prefetch and caches. Fastest clock with USB at 48MHz
+	CLK_PROFILE_MAX,			//180MHz, scale 1 with over-drive, prefetch and caches. USB is left off
+	CLK_PROFILE_COUNT,
+}clkProfile;
+
+typedef struct{
+	uint32_t sysclk;			/*!< Core clock [Hz] >*/
+	uint32_t pllm;				/*!< HSE divider, 2MHz into the VCO >*/
+	uint32_t plln;
+	uint32_t pllp;				/*!< RCC_PLLP_DIVx >*/
+	uint32_t pllq;				/*!< 48MHz domain divider (USB) >*/
+	uint32_t voltage_scale;		/*!< PWR_REGULATOR_VOLTAGE_SCALEx >*/
+	uint8_t overdrive;			/*!< Over-drive needed above 168MHz >*/
+	uint8_t prefetch;			/*!< ART prefetch, pays off with many wait states >*/
+	uint32_t flash_latency;		/*!< FLASH_LATENCY_x for 2.7-3.6V >*/
+	uint32_t apb1_div;			/*!< RCC_HCLK_DIVx, APB1 at most 45MHz >*/
+	uint32_t apb2_div;			/*!< RCC_HCLK_DIVx, APB2 at most 90MHz >*/
+}clkProfileConfig;
+
+extern const clkProfileConfig clk_profiles[CLK_PROFILE_COUNT];
+
+//Active profile, valid after CLK_Configure
+extern clkProfile clk_profile;
+
+/**
+ * \brief Set up the clock tree for a profile. Call once at boot, before any peripheral init,
+ * with the PLL still off (the regulator scale can only change then). Calls Error_Handler on failure
+ * \param [in]      profile profile to run
+ */
+void CLK_Configure(clkProfile profile);
+
+/**
+ * \brief Input clock of a timer, twice its bus clock when the bus is divided
+ * \param [in]      tim timer instance
+ * \return Timer kernel clock [Hz]
+ */
+uint32_t CLK_TimerClock(const TIM_TypeDef* tim);
+
+/**
+ * \brief Prescaler register value for a timer to count at the given rate
+ * \param [in]      tim timer instance
+ * \param [in]      count_hz counting rate, must divide the timer clock [Hz]
+ * \return Value for Init.Prescaler / PSC
+ */
+uint32_t CLK_TimerPrescaler(const TIM_TypeDef* tim, uint32_t count_hz);
+
+/**
+ * \brief Smallest SPI baud rate prescaler that keeps SCK at or under a limit
+ * \param [in]      spi SPI instance
+ * \param [in]      max_hz highest SCK the device takes [Hz]
+ * \return SPI_BAUDRATEPRESCALER_x, _256 if even that is too fast
+ */
+uint32_t CLK_SpiPrescaler(const SPI_TypeDef* spi, uint32_t max_hz);
+
+/**
+ * \brief Whether the 48MHz domain is at 48MHz, USB must not be started otherwise
+ * \return 1 if USB can run
+ */
+uint8_t CLK_UsbClockValid(void);
+
+#endif /* INC_CLOCK_PROFILE_H_ */
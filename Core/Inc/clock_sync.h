@@ -0,0 +1,87 @@
+/*
+ * clock_sync.h
+ *
+ * NTP style offset and drift estimate between the host clock and the microsecond timebase.
+ * The host sends a ping (seq, t1) carrying the arrival time t4 of the previous pong. The MCU stamps
+ * the ping on arrival (t2) and echoes seq and t2 in the next telemetry frame, whose own stamp is t3.
+ * With all four stamps of an exchange both ends can solve for the offset
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_CLOCK_SYNC_H_
+#define INC_CLOCK_SYNC_H_
+
+#include <stdint.h>
+
+//Filter gains of the offset/drift tracking loop, per exchange
+#define SYNC_OFFSET_GAIN		0.1f
+#define SYNC_DRIFT_GAIN			0.01f
+
+//Exchanges whose round trip is this much above the best seen are ignored [us]
+#define SYNC_DELAY_MARGIN		500
+
+typedef struct{
+	//Last ping, written by the main loop with interrupts masked so the telemetry interrupt
+	//never pairs a new seq with an old t2
+	uint64_t t1;				/*!< Host send time [us host] >*/
+	volatile uint32_t t2;		/*!< Time the ping started arriving [us] >*/
+	volatile uint32_t seq;
+	//Pong, written by the telemetry interrupt when it first echoes a seq
+	volatile uint32_t t3;		/*!< End of the first telemetry frame echoing seq [us] >*/
+	volatile uint32_t pong_seq;
+	//Estimate, host time = mcu time + offset + drift * (mcu time - ref)
+	uint64_t ref;				/*!< MCU time of the last update [us] >*/
+	int64_t offset;				/*!< Host minus MCU time at ref [us] >*/
+	float drift;				/*!< Host clock rate relative to the MCU, e.g. 1e-6 is 1 ppm >*/
+	uint32_t delay;				/*!< Round trip of the last exchange, link time only [us] >*/
+	uint32_t min_delay;			/*!< Best round trip seen [us] >*/
+	uint32_t exchanges;			/*!< Exchanges used >*/
+	uint32_t rejected;			/*!< Exchanges dropped for a long round trip >*/
+}clockSync_t;
+
+extern clockSync_t clock_sync;
+
+/**
+ * \brief Reset the estimate
+ * \param [in]      sync pointer to sync state
+ */
+void SYNC_Init(clockSync_t* sync);
+
+/**
+ * \brief Handle a ping. Completes the previous exchange if the host reports its pong arrival
+ * \param [in]      sync pointer to sync state
+ * \param [in]      seq ping sequence number
+ * \param [in]      t1 host send time [us host]
+ * \param [in]      prev_seq sequence number of the pong the host is reporting
+ * \param [in]      t4 host arrival time of that pong, 0 if none [us host]
+ * \param [in]      t2 time the ping started arriving [us]
+ * \param [in]      now current TB_Micros64 time
+ */
+void SYNC_Ping(clockSync_t* sync, uint32_t seq, uint64_t t1, uint32_t prev_seq, uint64_t t4,
+		uint32_t t2, uint64_t now);
+
+/**
+ * \brief Record the stamp of a telemetry frame. Call from the transmit path right before sending
+ * \param [in]      sync pointer to sync state
+ * \param [in]      t3 time the frame finishes sending [us]
+ */
+void SYNC_Pong(clockSync_t* sync, uint32_t t3);
+
+/**
+ * \brief Map MCU time to host time
+ * \param [in]      sync pointer to sync state
+ * \param [in]      mcu MCU time [us]
+ * \return Host time, 0 before the first exchange [us host]
+ */
+uint64_t SYNC_ToHost(const clockSync_t* sync, uint64_t mcu);
+
+/**
+ * \brief Map host time to MCU time
+ * \param [in]      sync pointer to sync state
+ * \param [in]      host host time [us host]
+ * \return MCU time [us]
+ */
+uint64_t SYNC_ToMcu(const clockSync_t* sync, uint64_t host);
+
+#endif /* INC_CLOCK_SYNC_H_ */
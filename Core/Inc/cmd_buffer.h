@@ -0,0 +1,101 @@
+/*
+ * cmd_buffer.h
+ *
+ * Timestamped wheel velocity commands from the host, played back at the control rate.
+ * Samples are interpolated a short delay behind the newest command. When the next one is late,
+ * or the stream has ended, the last command is held as it is: a slope carried on past it could
+ * run through zero and reverse the chair. Filled and sampled from the main loop
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_CMD_BUFFER_H_
+#define INC_CMD_BUFFER_H_
+
+#include <stdint.h>
+
+//Power of 2
+#define CMD_BUFFER_SIZE				64
+
+//Playback delay is the mean command interval plus a jitter margin, within these bounds [us]
+#define CMD_MIN_DELAY				2000
+#define CMD_MAX_DELAY				100000
+#define CMD_JITTER_MARGIN			2.0f
+
+//A gap this long between two commands restarts playback instead of interpolating across it [us]
+#define CMD_RESTART_GAP				200000
+
+typedef enum{
+	CMD_EMPTY,				/*!< Nothing to play yet >*/
+	CMD_INTERPOLATING,
+	CMD_HOLDING				/*!< No later command yet, last command held >*/
+}cmdState;
+
+typedef struct{
+	uint32_t stamp;			/*!< Time the command applies at, TB_Micros timebase [us] >*/
+	float left;				/*!< Wheel velocities [m/s] >*/
+	float right;
+}cmdPoint;
+
+typedef struct{
+	cmdPoint points[CMD_BUFFER_SIZE];
+	volatile uint32_t head;	/*!< Written by the producer only >*/
+	volatile uint32_t tail;	/*!< Written by the consumer only >*/
+	uint32_t last_arrival;	/*!< Producer side arrival statistics >*/
+	float interval;			/*!< Mean time between commands [us] >*/
+	float jitter;			/*!< Mean absolute deviation of the interval [us] >*/
+	volatile uint32_t delay;/*!< Playback delay [us] >*/
+	cmdPoint prev;			/*!< Consumer side, last point already reached >*/
+	uint8_t have_prev;
+	cmdState state;
+	uint32_t overflows;		/*!< Commands dropped on a full buffer >*/
+}cmdBuffer_t;
+
+extern cmdBuffer_t cmd_buffer;
+
+/**
+ * \brief Empty the buffer
+ * \param [in]      buf pointer to buffer
+ */
+void CMD_Init(cmdBuffer_t* buf);
+
+/**
+ * \brief Queue a command for a given time. Producer side
+ * \param [in]      buf pointer to buffer
+ * \param [in]      point command and the time it applies at, stamps must not go backwards
+ * \return 1 if queued, 0 if the buffer was full
+ */
+uint8_t CMD_Push(cmdBuffer_t* buf, const cmdPoint* point);
+
+/**
+ * \brief Queue a command stamped with its arrival time and update the playback delay. Scheduled commands
+ * not yet reached are dropped, so like CMD_PushSchedule this must be called from the consumer context
+ * \param [in]      buf pointer to buffer
+ * \param [in]      arrival arrival time [us]
+ * \param [in]      left left wheel velocity [m/s]
+ * \param [in]      right right wheel velocity [m/s]
+ * \return 1 if queued, 0 if the buffer was full
+ */
+uint8_t CMD_PushArrival(cmdBuffer_t* buf, uint32_t arrival, float left, float right);
+
+/**
+ * \brief Queue a run of scheduled commands, played back without a delay. Queued commands at or after
+ * the first new one are replaced, so this must be called from the consumer context
+ * \param [in]      buf pointer to buffer
+ * \param [in]      points commands in time order, at most CMD_RESTART_GAP apart
+ * \param [in]      count number of commands
+ * \return Number queued
+ */
+uint32_t CMD_PushSchedule(cmdBuffer_t* buf, const cmdPoint* points, uint32_t count);
+
+/**
+ * \brief Sample the command stream. Consumer side, call at the control rate
+ * \param [in]      buf pointer to buffer
+ * \param [in]      now current time [us]
+ * \param [out]     left left wheel velocity [m/s]
+ * \param [out]     right right wheel velocity [m/s]
+ * \return 1 if there is a command to follow
+ */
+uint8_t CMD_Sample(cmdBuffer_t* buf, uint32_t now, float* left, float* right);
+
+#endif /* INC_CMD_BUFFER_H_ */
@@ -0,0 +1,73 @@
+/*
+ * drive_mode.h
+ *
+ * Selects where the velocity command comes from: the local joystick or ROS.
+ * Both sources go through the same speed limiters, so a handover is jerk limited
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_DRIVE_MODE_H_
+#define INC_DRIVE_MODE_H_
+
+#include <stdint.h>
+#include <joystick.h>
+
+//Let the on-board joystick drive the chair. Without it the joystick only feeds telemetry
+//#define JOYSTICK_DRIVE
+
+//Joystick channel driving each axis
+#define DRIVE_JOY_LINEAR_AXIS		1
+#define DRIVE_JOY_ANGULAR_AXIS		0
+
+//Full deflection of the joystick
+#define DRIVE_JOY_MAX_LINEAR		1.0f	//m/s
+#define DRIVE_JOY_MAX_ANGULAR		1.0f	//rad/s, counter clockwise positive
+
+//ROS command older than this is ignored [ms]
+#define DRIVE_ROS_TIMEOUT			200
+
+//Joystick must be centred this long before ROS gets control back [ms]
+#define DRIVE_RELEASE_TIME			500
+
+//Joystick must read centred this long after start-up, or after its ADC stalled, before it may drive [ms]
+#define DRIVE_ARM_TIME				1000
+
+typedef enum{
+	DRIVE_IDLE,				/*!< No valid source, command is zero >*/
+	DRIVE_ROS,
+	DRIVE_JOYSTICK
+}driveSource;
+
+typedef struct{
+	driveSource source;
+	float linear;				/*!< Requested linear velocity before limiting [m/s] >*/
+	float angular;				/*!< Requested angular velocity before limiting [rad/s] >*/
+	uint32_t centred_since;		/*!< HAL tick the joystick returned to centre >*/
+	uint32_t arm_since;			/*!< HAL tick the joystick started reading centred while not armed >*/
+	uint8_t joy_armed;			/*!< Joystick read centred for DRIVE_ARM_TIME, it may take control >*/
+	uint32_t switches;			/*!< Number of source changes >*/
+}drive_t;
+
+extern drive_t drive;
+
+/**
+ * \brief Start idle with the joystick not armed
+ * \param [in]      drv pointer to drive struct
+ */
+void DRIVE_Init(drive_t* drv);
+
+/**
+ * \brief Pick the command source for this tick and fill in the request
+ * \param [in]      drv pointer to drive struct
+ * \param [in]      joy joystick state
+ * \param [in]      ros_left left wheel velocity from ROS [m/s]
+ * \param [in]      ros_right right wheel velocity from ROS [m/s]
+ * \param [in]      ros_tick HAL tick the last valid ROS frame arrived, 0 if none
+ * \param [in]      e_stop emergency stop engaged
+ * \param [in]      tick current HAL tick [ms]
+ */
+void DRIVE_Update(drive_t* drv, const joystick_t* joy, float ros_left, float ros_right,
+		uint32_t ros_tick, uint8_t e_stop, uint32_t tick);
+
+#endif /* INC_DRIVE_MODE_H_ */
@@ -10,13 +10,41 @@
 #define ENCODER2_CS_PIN			GPIO_PIN_8
 
 #define ENCODER_MAX				16384
+#define ENCODER_SPI_TIMEOUT		1		//ms, per byte transfer
+//Highest SCK of each encoder bus, the AMT22 limit of 2MHz. The prescalers are picked for the active
+//clock profile, 1.3MHz at 168MHz
+#define ENCODER1_SPI_HZ			2000000	//SPI1
+#define ENCODER2_SPI_HZ			2000000	//SPI6
+
+//Number of consecutive rejected frames that are extrapolated from the last good
+//count difference. Past this the last position is held until a good frame arrives
+#define ENCODER_MAX_EXTRAPOLATE	5
 
 #define ENCODER1_CS_HIGH		HAL_GPIO_WritePin(ENCODER1_CS_PORT, ENCODER1_CS_PIN, GPIO_PIN_SET)
 #define ENCODER1_CS_LOW			HAL_GPIO_WritePin(ENCODER1_CS_PORT, ENCODER1_CS_PIN, GPIO_PIN_RESET)
 #define ENCODER2_CS_HIGH		HAL_GPIO_WritePin(ENCODER2_CS_PORT, ENCODER2_CS_PIN, GPIO_PIN_SET)
 #define ENCODER2_CS_LOW			HAL_GPIO_WritePin(ENCODER2_CS_PORT, ENCODER2_CS_PIN, GPIO_PIN_RESET)
 
-void encoderRead(uint16_t *encoder_vals);
+typedef struct{
+	uint32_t error_count;			/*!< Frames rejected by the checksum bits >*/
+	uint32_t timeout_count;			/*!< SPI transfers that did not complete >*/
+	uint16_t consecutive_faults;	/*!< Current run of rejected frames, cleared by the next good frame >*/
+	uint16_t max_consecutive_faults;/*!< Longest run of rejected frames since boot >*/
+	int16_t last_delta;				/*!< Count difference between the last two samples, used to extrapolate >*/
+	uint16_t last_position;			/*!< Last position handed out, good or extrapolated >*/
+	uint8_t has_position;			/*!< Set once the first good frame has been received >*/
+}encoderStatus;
+
+//Per encoder fault accounting, indexed by LEFT_INDEX/RIGHT_INDEX
+extern encoderStatus encoder_status[2];
+
+/**
+ * \brief Read both encoders and validate each frame against its checksum bits
+ * \param [out] encoder_vals 14 bit positions. A rejected frame is replaced by an
+ *                           extrapolated (or held) position
+ * \return Bitmask of encoders with a good frame, bit LEFT_INDEX/RIGHT_INDEX
+ */
+uint8_t encoderRead(uint16_t *encoder_vals);
 void calcVelFromEncoder(uint16_t *encoder_vals, double *velocities);
 
 extern double unfiltered_vel[2];
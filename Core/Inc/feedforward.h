@@ -0,0 +1,74 @@
+/*
+ * feedforward.h
+ *
+ * Speed dependent feedforward gains per wheel and direction, looked up from tables
+ * generated by script/gen_feedforward.py
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_FEEDFORWARD_H_
+#define INC_FEEDFORWARD_H_
+
+#include <stdint.h>
+
+//Table sets, one per control regime since the gains are in different units
+#define FF_BY					0	//Motor command counts per m/s
+#define FF_CX					1	//Volts per m/s
+#define FF_CONTROLLERS			2
+
+#define FF_FORWARD				0
+#define FF_REVERSE				1
+
+//Battery voltage and driver efficiency, converts a CX voltage to a Sabertooth command
+#define FF_SUPPLY_VOLTS			25.2f
+#define FF_DRIVER_EFFICIENCY	0.9735f
+#define FF_COMMAND_FULL_SCALE	2047
+
+typedef struct{
+	float speed_min;		/*!< Speed of the first entry [m/s] >*/
+	float inv_step;			/*!< Inverse of the spacing between entries [s/m] >*/
+	uint16_t size;			/*!< Number of entries >*/
+	const float* gain;		/*!< Gain at each grid point >*/
+}ffTable;
+
+//Generated tables, indexed [controller][wheel][direction]
+extern const ffTable ff_tables[FF_CONTROLLERS][2][2];
+
+/**
+ * \brief Select the generated tables of one control regime for both wheels
+ * \param [in]      controller FF_BY or FF_CX
+ */
+void FF_Init(uint8_t controller);
+
+/**
+ * \brief Swap in a table, e.g. one built from a new characterisation at runtime
+ * \param [in]      wheel LEFT_INDEX or RIGHT_INDEX
+ * \param [in]      direction FF_FORWARD or FF_REVERSE
+ * \param [in]      table table to use, must stay valid while active
+ */
+void FF_SetTable(uint8_t wheel, uint8_t direction, const ffTable* table);
+
+/**
+ * \brief Feedforward gain for a wheel setpoint, linearly interpolated
+ * \param [in]      wheel LEFT_INDEX or RIGHT_INDEX
+ * \param [in]      setpoint wheel velocity setpoint [m/s], the sign picks the direction
+ * \return Gain to use as the PID F term
+ */
+float FF_Gain(uint8_t wheel, float setpoint);
+
+/**
+ * \brief Convert a motor voltage to a motor command
+ * \param [in]      volts voltage across the motor [V]
+ * \return Command in +-FF_COMMAND_FULL_SCALE
+ */
+float FF_VoltsToCommand(float volts);
+
+/**
+ * \brief Convert a motor command back to the voltage the driver applies for it
+ * \param [in]      command motor command, saturated at +-FF_COMMAND_FULL_SCALE like the driver does
+ * \return Voltage across the motor [V]
+ */
+float FF_CommandToVolts(float command);
+
+#endif /* INC_FEEDFORWARD_H_ */
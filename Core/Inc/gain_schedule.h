@@ -0,0 +1,60 @@
+/*
+ * gain_schedule.h
+ *
+ * Speed scheduled wheel PID gains and output ramp limits, one table for accelerating
+ * and one for decelerating. F is scheduled separately by the feedforward tables
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_GAIN_SCHEDULE_H_
+#define INC_GAIN_SCHEDULE_H_
+
+#include <stdint.h>
+#include "pid.h"
+
+#define GS_ACCEL		0
+#define GS_DECEL		1
+
+typedef struct{
+	float speed;			/*!< Wheel speed of this point, ascending within a table [m/s] >*/
+	float p_scale;			/*!< Multipliers on the base P and I gains >*/
+	float i_scale;
+	float ramp_rate;		/*!< Output ramp rate while the output magnitude grows [units/s] >*/
+	float descent_rate;		/*!< Output descent rate while it shrinks, positive [units/s] >*/
+}gsPoint;
+
+typedef struct{
+	const gsPoint* points;
+	uint8_t size;
+}gsTable;
+
+typedef struct{
+	gsTable table[2];		/*!< Indexed by GS_ACCEL or GS_DECEL >*/
+	float base_p;			/*!< Gains the scales apply to, hand tuned or from autotune >*/
+	float base_i;
+	uint8_t direction;		/*!< Direction of the last update >*/
+	float speed;			/*!< Scheduling speed of the last update [m/s] >*/
+}gainSchedule_t;
+
+/**
+ * \brief Initialise a schedule
+ * \param [in]      gs pointer to schedule
+ * \param [in]      accel table used while the wheel speeds up
+ * \param [in]      decel table used while the wheel slows down
+ * \param [in]      base_p P gain at a scale of 1
+ * \param [in]      base_i I gain at a scale of 1
+ */
+void GS_Init(gainSchedule_t* gs, const gsTable* accel, const gsTable* decel,
+		float base_p, float base_i);
+
+/**
+ * \brief Interpolate the schedule for the current setpoint and velocity and load it into the PID
+ * \param [in]      gs pointer to schedule
+ * \param [in]      pid wheel PID
+ * \param [in]      setpoint wheel velocity setpoint [m/s]
+ * \param [in]      velocity measured wheel velocity [m/s]
+ */
+void GS_Apply(gainSchedule_t* gs, PID_Struct* pid, float setpoint, float velocity);
+
+#endif /* INC_GAIN_SCHEDULE_H_ */
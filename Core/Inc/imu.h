@@ -13,6 +13,10 @@
 
 #define SW_RESET			0b00000101
 
+//CTRL3_C (same register as SW_RESET_REG) settings
+#define CTRL3_C_BDU			0b01000000	//Output registers not updated until both bytes are read
+#define CTRL3_C_IF_INC		0b00000100	//Register address auto increments during a burst
+
 //Acceleration config register and available settings
 #define ACC_CONFIG_REG 		0x10
 
@@ -62,17 +66,47 @@
 #define GYRO_1000_DPS		0b00001000
 #define GYRO_2000_DPS 		0b00001100
 
+//Sensitivity for the configured full scale (datasheet table 3)
+#define ACC_SENSITIVITY_2G			0.061e-3f	//g/LSB
+#define GYRO_SENSITIVITY_500DPS		17.50e-3f	//dps/LSB
+
+
+//Output data rate configured in IMU_Init
+#define IMU_ODR_HZ					1660
+
+//Consecutive samples with z acceleration at full scale before the IMU is taken for hung. A bump or a kerb
+//saturates it for a few ms at most, a hung IMU keeps reading full scale (30ms at IMU_ODR_HZ)
+#define IMU_HANG_SAMPLES			50
 
 //Defined funtions to set and unset chip select pin
 #define IMU_CS_PORT					GPIOA
 #define IMU_CS_PIN					GPIO_PIN_8
 #define IMU_SPI						hspi4
+#define IMU_SPI_HZ					10000000	//Highest SCK of the LSM6DS33, the prescaler follows the clock profile
 #define IMU_CS_HIGH					HAL_GPIO_WritePin(IMU_CS_PORT, IMU_CS_PIN, GPIO_PIN_SET)
 #define IMU_CS_LOW					HAL_GPIO_WritePin(IMU_CS_PORT, IMU_CS_PIN, GPIO_PIN_RESET)
 
 void IMU_Init(void);
 void IMU_Reg_Write(uint8_t reg, uint8_t value);
 int IMU_Reg_Read(uint8_t reg, uint8_t *buf, uint8_t size);
-void imuRead(int16_t *acc, int16_t *gyro, double exponentialFilter);
+
+/**
+ * \brief Read a new sample if one is ready
+ * \return 1 if a new sample was read, the raw sample is left in imu_acc_raw/imu_gyro_raw
+ */
+uint8_t imuRead(void);
+
+/**
+ * \brief Convert a raw sample to SI units
+ * \param [in]      acc_raw raw acceleration
+ * \param [in]      gyro_raw raw angular rate
+ * \param [out]     acc acceleration [m/s2]
+ * \param [out]     gyro angular rate [rad/s]
+ */
+void imuConvert(const int16_t *acc_raw, const int16_t *gyro_raw, float *acc, float *gyro);
+
+//Last unfiltered sample read by imuRead
+extern int16_t imu_acc_raw[3];
+extern int16_t imu_gyro_raw[3];
 
 #endif
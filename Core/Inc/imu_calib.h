@@ -0,0 +1,159 @@
+/*
+ * imu_calib.h
+ *
+ * Calibration of the LSM6DS33 samples: stored accel offset/scale and mounting rotation,
+ * gyro bias learnt online whenever the chair is standing still. Offset and scale come from a six
+ * position calibration of the board on the bench, each axis pointing up then down. The rotation comes
+ * from one more capture with the board mounted and the chair on level ground, it levels the z axis
+ * only, gravity says nothing about the yaw of the mounting. Captures and the flash write are requested
+ * over USB, see script/ImuCalib.py
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_IMU_CALIB_H_
+#define INC_IMU_CALIB_H_
+
+#include <stdint.h>
+
+//Both wheels slower than this count as standing still [m/s]
+#define CALIB_STILL_VEL			0.005f
+
+//Time the wheels must stay still before the gyro is trusted to read its bias [ms]
+#define CALIB_STILL_TIME		500
+
+//Gyro deviation from the current bias above which the chair is being rocked or pushed [rad/s]
+#define CALIB_STILL_GYRO		0.05f
+
+//Bias tracking time constant while standing still [s]
+#define CALIB_BIAS_TAU			2.0f
+
+//Longest sample interval used for the bias update [s]
+#define CALIB_MAX_DT			0.01f
+
+//Standstill time required before the bias estimate is considered settled [ms]
+#define CALIB_BIAS_SETTLE		5000
+
+//Change of bias that is worth a flash write [rad/s]
+#define CALIB_SAVE_DELTA		0.002f
+
+//Accel norm outside g*(1 +- tolerance) while standing still is counted as a fault
+#define CALIB_ACC_TOLERANCE		0.15f
+
+//Samples averaged per calibration pose, the average restarts whenever the gyro is not quiet
+#define CALIB_POSE_SAMPLES		1000
+
+//Tilt of the level capture above which it is taken for a wrong pose [rad]
+#define CALIB_MAX_TILT			0.5f
+
+//USB cargo tags. The host starts a capture with { CALIB_TAG_REQUEST, calibPose } or asks for the
+//flash write with { CALIB_TAG_REQUEST, CALIB_REQUEST_SAVE }. Each is answered with
+//{ CALIB_TAG_RESULT, pose or CALIB_REQUEST_SAVE, calibStatus, poses done bits, averaged accel x, y, z }
+#define CALIB_TAG_REQUEST		0x43
+#define CALIB_TAG_RESULT		0x4B
+#define CALIB_REQUEST_SAVE		0x80
+
+#define CALIB_VERSION			1
+
+typedef enum{
+	CALIB_POSE_X_UP = 0,		//Named after the sensor axis pointing up
+	CALIB_POSE_X_DOWN,
+	CALIB_POSE_Y_UP,
+	CALIB_POSE_Y_DOWN,
+	CALIB_POSE_Z_UP,
+	CALIB_POSE_Z_DOWN,
+	CALIB_POSE_LEVEL,			//Mounted, chair on level ground. Capture after the six faces
+	CALIB_POSE_COUNT,
+}calibPose;
+
+typedef enum{
+	CALIB_OK = 0,
+	CALIB_WRONG_POSE,			//Gravity is not along the requested axis, or the chair is tilted
+	CALIB_OUT_OF_RANGE,			//Up and down of an axis give a gain off by more than CALIB_ACC_TOLERANCE
+	CALIB_SAVE_FAILED,
+}calibStatus;
+
+typedef struct{
+	uint32_t version;
+	float acc_offset[3];		/*!< Subtracted from the accel before scaling [m/s2] >*/
+	float acc_scale[3];			/*!< Per axis accel gain >*/
+	float rotation[3][3];		/*!< Sensor to chair frame (x forward, z up) >*/
+	float gyro_bias[3];			/*!< Gyro bias at the last save [rad/s] >*/
+}imuCalibParams;
+
+typedef struct{
+	imuCalibParams params;		/*!< Stored calibration >*/
+	float gyro_bias[3];			/*!< Online gyro bias estimate [rad/s] >*/
+	float acc[3];				/*!< Calibrated acceleration in the chair frame [m/s2] >*/
+	float gyro[3];				/*!< Calibrated angular rate in the chair frame [rad/s] >*/
+	uint32_t still_since;		/*!< HAL tick the wheels stopped, 0 while moving >*/
+	uint32_t bias_time;			/*!< Standstill time accumulated into the bias [ms] >*/
+	uint32_t acc_faults;		/*!< Implausible accel norm while standing still >*/
+	uint8_t stationary;			/*!< Wheels stopped for CALIB_STILL_TIME and the gyro is quiet >*/
+	uint8_t loaded;				/*!< Parameters were read back from flash >*/
+	uint8_t saved;				/*!< Parameters have been written this boot >*/
+	uint8_t save_requested;		/*!< Host asked for a flash write, done at the next parked save >*/
+	uint8_t capturing;			/*!< A pose is being averaged >*/
+	uint8_t pose;				/*!< Pose being captured or last reported, calibPose or CALIB_REQUEST_SAVE >*/
+	uint8_t poses_done;			/*!< Bit per calibPose captured this boot >*/
+	uint16_t pose_samples;		/*!< Samples in pose_sum >*/
+	float pose_sum[3];
+	float pose_acc[CALIB_POSE_COUNT][3];	/*!< Average per pose, uncorrected for the faces [m/s2] >*/
+	uint8_t report;				/*!< Result waiting to be sent >*/
+	uint8_t status;				/*!< calibStatus of the result >*/
+}imuCalib_t;
+
+extern imuCalib_t imu_calib;
+
+/**
+ * \brief Load the stored calibration, identity if there is none
+ * \param [in]      calib pointer to calibration struct
+ */
+void CALIB_Init(imuCalib_t* calib);
+
+/**
+ * \brief Track standstill from the wheel speeds, call at the control rate
+ * \param [in]      calib pointer to calibration struct
+ * \param [in]      wheel_vel left and right wheel velocity [m/s]
+ * \param [in]      tick current HAL tick [ms]
+ */
+void CALIB_UpdateStandstill(imuCalib_t* calib, const double* wheel_vel, uint32_t tick);
+
+/**
+ * \brief Calibrate one IMU sample, learning the gyro bias if standing still
+ * \param [in]      calib pointer to calibration struct
+ * \param [in]      acc acceleration from imuConvert [m/s2]
+ * \param [in]      gyro angular rate from imuConvert [rad/s]
+ * \param [in]      dt time since the previous sample [s]
+ */
+void CALIB_Apply(imuCalib_t* calib, const float* acc, const float* gyro, float dt);
+
+/**
+ * \brief Handle a host request, CALIB_TAG_REQUEST cargo without the tag
+ * \param [in]      calib pointer to calibration struct
+ * \param [in]      request calibPose to capture or CALIB_REQUEST_SAVE
+ */
+void CALIB_Request(imuCalib_t* calib, uint8_t request);
+
+/**
+ * \brief Send a pending result over USB, call until it returns 0
+ * \param [in]      calib pointer to calibration struct
+ * \return 1 while a result is still waiting
+ */
+uint8_t CALIB_Flush(imuCalib_t* calib);
+
+/**
+ * \brief Whether the host asked for a save, or the online bias has settled and moved far enough from
+ * the stored one to be saved
+ * \param [in]      calib pointer to calibration struct
+ */
+uint8_t CALIB_SaveDue(imuCalib_t* calib);
+
+/**
+ * \brief Write the calibration with the current bias to flash. Stalls the CPU, see PARAM_Save
+ * \param [in]      calib pointer to calibration struct
+ * \return 1 on success
+ */
+uint8_t CALIB_Save(imuCalib_t* calib);
+
+#endif /* INC_IMU_CALIB_H_ */
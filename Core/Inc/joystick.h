@@ -0,0 +1,85 @@
+/*
+ * joystick.h
+ *
+ * Joystick on ADC1 channel 0 and 1. Conversions are triggered by TIM2 into a circular DMA
+ * buffer and processed a half buffer at a time
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_JOYSTICK_H_
+#define INC_JOYSTICK_H_
+
+#include <stdint.h>
+#include <biquad.h>
+
+#define JOY_CHANNELS			2
+
+//Scan rate set by TIM2 [Hz]
+#define JOY_SAMPLE_HZ			4000
+
+//Scans averaged per half buffer. The F4 ADC has no hardware oversampling, this is done in software
+#define JOY_OVERSAMPLE			8
+
+//Rate at which averaged samples come out of the pipeline [Hz]
+#define JOY_BLOCK_HZ			(JOY_SAMPLE_HZ / JOY_OVERSAMPLE)
+
+//DMA buffer, two halves of JOY_OVERSAMPLE interleaved scans
+#define JOY_DMA_LENGTH			(2 * JOY_OVERSAMPLE * JOY_CHANNELS)
+
+//Low pass after the averaging [Hz]
+#define JOY_LPF_HZ				25.0f
+
+//A block not seen for this long means the ADC has stopped [ms]
+#define JOY_TIMEOUT				20
+
+typedef struct{
+	float centre;			/*!< Reading at rest [counts] >*/
+	float span_pos;			/*!< Counts from centre to full deflection above the centre >*/
+	float span_neg;			/*!< Counts from centre to full deflection below the centre >*/
+	float deadzone;			/*!< Fraction of the span mapped to 0 >*/
+	int8_t sign;			/*!< 1 or -1 to flip the axis >*/
+}joystickAxisCal;
+
+typedef struct{
+	joystickAxisCal cal[JOY_CHANNELS];
+	biquadFilter lpf[JOY_CHANNELS];
+	float raw[JOY_CHANNELS];		/*!< Averaged and filtered reading [counts] >*/
+	float axis[JOY_CHANNELS];		/*!< Normalised deflection [-1, 1] >*/
+	uint32_t stamp;					/*!< HAL tick of the last block >*/
+	uint32_t blocks;				/*!< Blocks processed >*/
+}joystick_t;
+
+extern joystick_t joystick;
+extern uint16_t joystick_dma[JOY_DMA_LENGTH];
+
+/**
+ * \brief Default calibration for a centred 12 bit stick and reset the filters
+ * \param [in]      joy pointer to joystick struct
+ */
+void JOY_Init(joystick_t* joy);
+
+/**
+ * \brief Average, filter and map one half of the DMA buffer. Called from the DMA callbacks
+ * \param [in]      joy pointer to joystick struct
+ * \param [in]      samples JOY_OVERSAMPLE interleaved scans
+ * \param [in]      tick current HAL tick [ms]
+ */
+void JOY_ProcessBlock(joystick_t* joy, const uint16_t* samples, uint32_t tick);
+
+/**
+ * \brief Map a reading to [-1, 1] with a deadzone around the centre
+ * \param [in]      cal axis calibration
+ * \param [in]      raw reading [counts]
+ * \return Normalised deflection, rescaled so the edge of the deadzone maps to 0
+ */
+float JOY_Map(const joystickAxisCal* cal, float raw);
+
+/**
+ * \brief Whether the ADC pipeline is still delivering blocks
+ * \param [in]      joy pointer to joystick struct
+ * \param [in]      tick current HAL tick [ms]
+ */
+uint8_t JOY_Alive(const joystick_t* joy, uint32_t tick);
+
+#endif /* INC_JOYSTICK_H_ */
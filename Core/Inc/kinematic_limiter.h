@@ -0,0 +1,64 @@
+/*
+ * kinematic_limiter.h
+ *
+ * Differential drive command limits checked on the wheels. Linear and angular velocity are
+ * always scaled by the same factor so the commanded curvature is kept. The command moves from its
+ * last value to the request along a straight line in (linear, angular), following one jerk limited
+ * profile of the fraction of that step covered. Starting from rest, stopping, or changing speed on
+ * the same arc keeps the curvature exactly. Only a request of another curvature bends the path
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_KINEMATIC_LIMITER_H_
+#define INC_KINEMATIC_LIMITER_H_
+
+#include <stdint.h>
+#include "speed_limiter.h"
+
+typedef struct{
+	float base_width;		/*!< Distance between the wheels [m] >*/
+	float max_wheel_vel;	/*!< Wheel speed limit, either direction [m/s] >*/
+	float max_wheel_acc;	/*!< Wheel acceleration limit, either direction [m/s2] >*/
+	const speedConfig* linear;	/*!< Linear velocity, acceleration and jerk limits >*/
+	const speedConfig* angular;	/*!< Angular velocity, acceleration and jerk limits [rad/s...] >*/
+}kinematicConfig;
+
+typedef struct{
+	const kinematicConfig* cfg;
+	float linear;			/*!< Last output [m/s] >*/
+	float angular;			/*!< Last output [rad/s] >*/
+	float start[2];			/*!< Output the running profile started from, linear then angular >*/
+	float target[2];		/*!< Request the running profile leads to >*/
+	sCurve profile;			/*!< Fraction of the step from start to target covered, 0 to 1 >*/
+	float vel_scale;		/*!< Factor the last request was scaled by to respect the speed limits >*/
+	uint32_t last_t;		/*!< HAL tick of the last KL_Limit >*/
+}kinematicLimiter_t;
+
+/**
+ * \brief Initialise a limiter at rest
+ * \param [in]      kl pointer to limiter
+ * \param [in]      cfg wheel limits, must stay valid
+ */
+void KL_Init(kinematicLimiter_t* kl, const kinematicConfig* cfg);
+
+/**
+ * \brief Scale a request down until both wheels and both axes are within their speed limits
+ * \param [in]      kl pointer to limiter
+ * \param [in, out] linear linear velocity [m/s]
+ * \param [in, out] angular angular velocity, counter clockwise positive [rad/s]
+ */
+void KL_LimitRequest(kinematicLimiter_t* kl, float* linear, float* angular);
+
+/**
+ * \brief Move the output towards the request along the shared profile. Its acceleration and jerk are
+ * the largest that keep both axes and both wheels within their limits for this step. A new request is
+ * planned from the current output and its acceleration along the new step
+ * \param [in]      kl pointer to limiter
+ * \param [in, out] linear linear velocity [m/s]
+ * \param [in, out] angular angular velocity, counter clockwise positive [rad/s]
+ * \param [in]      tick current HAL tick [ms]
+ */
+void KL_Limit(kinematicLimiter_t* kl, float* linear, float* angular, uint32_t tick);
+
+#endif /* INC_KINEMATIC_LIMITER_H_ */
@@ -0,0 +1,46 @@
+/*
+ * mem_sections.h
+ *
+ * Placement of hot data and code, sections are laid out in the linker scripts.
+ * CCMRAM sits on the core D-bus only, so the control state there never waits behind DMA on the bus
+ * matrix. DMA can not reach it either: buffers used by DMA (UART, ADC) stay in the default SRAM
+ * sections, and with the stack in CCMRAM DMA must never be pointed at a local variable.
+ * Both placements are off until their worst tick has been measured against the SRAM build, with
+ * LOOP_BENCHMARK or telemetry word 53
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_MEM_SECTIONS_H_
+#define INC_MEM_SECTIONS_H_
+
+//Define to run the hot control functions from SRAM instead of flash. With the ART accelerator flash
+//fetches are mostly zero wait already, so check the loop time with and without it
+//#define RAMFUNC_HOT_PATH
+
+//Define to move the per-tick control state into CCMRAM. The stack follows _Ccmram_Stack in the
+//linker script
+//#define CCMRAM_HOT_DATA
+
+#ifdef CCMRAM_HOT_DATA
+//Initialised data in CCMRAM, copied from flash by the startup code
+#define CCMRAM				__attribute__((section(".ccmram")))
+//Zero initialised data in CCMRAM, cleared by the startup code
+#define CCMRAM_BSS			__attribute__((section(".ccmram_bss")))
+#else
+#define CCMRAM
+#define CCMRAM_BSS
+#endif
+//CCMRAM left alone by the startup code, keeps its content over a reset
+#define CCMRAM_NOINIT		__attribute__((section(".ccmram_noinit")))
+//SRAM left alone by the startup code, keeps its content over a reset
+#define NOINIT				__attribute__((section(".noinit")))
+
+//Code copied to SRAM with the initialised data. The linker adds long branch veneers for the calls
+#ifdef RAMFUNC_HOT_PATH
+#define RAMFUNC				__attribute__((section(".RamFunc"), noinline))
+#else
+#define RAMFUNC
+#endif
+
+#endif /* INC_MEM_SECTIONS_H_ */
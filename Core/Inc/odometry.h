@@ -0,0 +1,62 @@
+/*
+ * odometry.h
+ *
+ * Differential drive dead reckoning, integrated at the control rate
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_ODOMETRY_H_
+#define INC_ODOMETRY_H_
+
+#include <stdint.h>
+#include <main.h>
+
+//Distance travelled by a wheel per encoder count [m]
+#define ODOM_M_PER_TICK			(M_PI * WHEEL_DIA / ENCODER_MAX)
+
+//Set to 0 to integrate heading from the encoders only
+#define ODOM_USE_GYRO			1
+
+//Sign of the LSM6DS33 z axis relative to the chair yaw (counter clockwise positive)
+#define ODOM_GYRO_Z_SIGN		1.0f
+
+//Rate at which the encoder yaw rate pulls the gyro bias estimate [1/s]
+//Small enough that wheel slip barely moves the bias, large enough to track drift
+#define ODOM_BIAS_GAIN			0.05f
+
+typedef struct{
+	float x;				/*!< Position in the odometry frame [m] >*/
+	float y;				/*!< Position in the odometry frame [m] >*/
+	float theta;			/*!< Heading [rad], wrapped to [-pi, pi] >*/
+	float v;				/*!< Linear velocity over the last update [m/s] >*/
+	float w;				/*!< Fused yaw rate [rad/s] >*/
+	int64_t ticks[2];		/*!< Accumulated wheel counts, forward positive >*/
+	uint32_t stamp;			/*!< HAL tick of the last update [ms] >*/
+}odomPose;
+
+typedef struct{
+	odomPose pose;			/*!< Working estimate, only touched by ODOM_Update >*/
+	odomPose published;		/*!< Consistent copy for readers in interrupt context >*/
+	float gyro_bias;		/*!< Gyro z bias estimated against the encoders [rad/s] >*/
+	uint16_t last_enc[2];	/*!< Encoder positions at the last update >*/
+	uint8_t initialised;
+}odometry_t;
+
+extern odometry_t odometry;
+
+/**
+ * \brief Reset the pose to the origin and clear the tick counters
+ * \param [in]      odom pointer to odometry struct
+ */
+void ODOM_Init(odometry_t* odom);
+
+/**
+ * \brief Integrate one control tick of wheel motion and yaw rate
+ * \param [in]      odom pointer to odometry struct
+ * \param [in]      encoder_vals 14 bit encoder positions from encoderRead
+ * \param [in]      gyro_z yaw rate from the IMU [rad/s]
+ */
+void ODOM_Update(odometry_t* odom, uint16_t* encoder_vals, float gyro_z);
+
+#endif /* INC_ODOMETRY_H_ */
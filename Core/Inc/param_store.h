@@ -0,0 +1,48 @@
+/*
+ * param_store.h
+ *
+ * Small parameter blocks kept in the last flash sector, written as an append only log
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_PARAM_STORE_H_
+#define INC_PARAM_STORE_H_
+
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+
+//Sector 11 is reserved in STM32F429IGTX_FLASH.ld, the application must not grow into it
+#define PARAM_SECTOR			FLASH_SECTOR_11
+#define PARAM_START_ADDR		0x080E0000U
+#define PARAM_END_ADDR			0x08100000U
+
+//Largest single block and the RAM used to carry the live blocks over an erase [bytes]
+#define PARAM_MAX_SIZE			256
+#define PARAM_MAX_LIVE			1024
+
+//Block ids, one per user of the store
+#define PARAM_ID_IMU_CALIB		0x0001
+#define PARAM_ID_WHEEL_GAINS	0x0002
+
+/**
+ * \brief Load the newest copy of a block
+ * \param [in]      id block id
+ * \param [out]     data destination
+ * \param [in]      size expected size of the block in bytes
+ * \return 1 if a block with matching id, size and CRC was found
+ */
+uint8_t PARAM_Load(uint16_t id, void* data, uint16_t size);
+
+/**
+ * \brief Append a new copy of a block, erasing the sector when it is full
+ * \note Programming stalls instruction fetch from flash and an erase takes 1-2s.
+ *       Only call while the motors are braked
+ * \param [in]      id block id
+ * \param [in]      data source
+ * \param [in]      size size of the block in bytes
+ * \return 1 on success
+ */
+uint8_t PARAM_Save(uint16_t id, const void* data, uint16_t size);
+
+#endif /* INC_PARAM_STORE_H_ */
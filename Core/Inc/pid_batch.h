@@ -0,0 +1,79 @@
+/*
+ * pid_batch.h
+ *
+ * Several PID controllers stepped together in structure of arrays form against one dt.
+ * Same control law as PID_getOutput, written without branches so the loops vectorise
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_PID_BATCH_H_
+#define INC_PID_BATCH_H_
+
+#include <stdint.h>
+#include "pid.h"
+
+//Multiple of 4 so the loops have no remainder
+#define PIDB_MAX		4
+
+typedef struct{
+	uint32_t n;					/*!< Controllers in use >*/
+	float p[PIDB_MAX];
+	float i[PIDB_MAX];
+	float d[PIDB_MAX];
+	float f[PIDB_MAX];
+	float i_max[PIDB_MAX];		/*!< Integral output clamp, symmetric >*/
+	float out_min[PIDB_MAX];
+	float out_max[PIDB_MAX];
+	float ramp[PIDB_MAX];		/*!< Output rate limit while the magnitude grows [units/s] >*/
+	float descent[PIDB_MAX];	/*!< Output rate limit while it shrinks, positive [units/s] >*/
+	float error_sum[PIDB_MAX];
+	float prev_error[PIDB_MAX];
+	float last_output[PIDB_MAX];
+	uint8_t first_run[PIDB_MAX];
+}pidBatch_t;
+
+/**
+ * \brief Clear a batch
+ * \param [in]      batch pointer to batch
+ */
+void PIDB_Init(pidBatch_t* batch);
+
+/**
+ * \brief Copy the tuning of a scalar controller into a slot, limits it leaves disabled become infinite
+ * \param [in]      batch pointer to batch
+ * \param [in]      idx slot, the batch grows to include it
+ * \param [in]      pid configured scalar controller, only its settings are read
+ */
+void PIDB_Load(pidBatch_t* batch, uint32_t idx, const PID_Struct* pid);
+
+/**
+ * \brief Clear the integrator and history of one controller, see PID_reset
+ * \param [in]      batch pointer to batch
+ * \param [in]      idx slot
+ */
+void PIDB_Reset(pidBatch_t* batch, uint32_t idx);
+
+/**
+ * \brief Step all controllers
+ * \param [in]      batch pointer to batch
+ * \param [in]      actual measurement of each controller
+ * \param [in]      setpoint setpoint of each controller
+ * \param [in]      dt time since the last step [s]
+ * \param [out]     output controller outputs
+ */
+void PIDB_Step(pidBatch_t* batch, const float* actual, const float* setpoint, float dt,
+		float* output);
+
+/**
+ * \brief Compare the batch against PID_getOutput with the DWT cycle counter, DWT_Init first
+ * \param [in]      batch pointer to a loaded batch, its state is left untouched
+ * \param [in]      pids scalar controllers matching the batch slots, left untouched
+ * \param [in]      iterations steps to average over
+ * \param [out]     scalar_cycles cycles per step of all scalar controllers
+ * \return Cycles per batch step
+ */
+float PIDB_Benchmark(const pidBatch_t* batch, const PID_Struct* pids, uint32_t iterations,
+		float* scalar_cycles);
+
+#endif /* INC_PID_BATCH_H_ */
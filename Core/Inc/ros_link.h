@@ -0,0 +1,89 @@
+/*
+ * ros_link.h
+ *
+ * Command stream from ROS on a circular DMA buffer, parsed from the main loop.
+ * Two frame types share the link:
+ *  - legacy: left, right wheel velocity (int16, mm/s), 0xFFFB. 6 bytes
+ *  - batch: a run of future setpoints queued into the command buffer and played back at the
+ *    control rate. 0xAA55, type, count, start (uint32, us after reception),
+ *    count * { offset (uint16, ms after start), a, b (int16, 1e-3) }, CRC-16/CCITT over type..last point.
+ *    Type LINK_BATCH_WHEEL carries left/right wheel velocities [m/s], LINK_BATCH_CHASSIS linear [m/s]
+ *    and angular [rad/s, counter clockwise positive]. 0xAA55 as a legacy velocity would be -21.9 m/s,
+ *    so the two can not be confused. With LINK_BATCH_ABSOLUTE set in type, start is the low 32 bits
+ *    of host time [us] instead, mapped through clock_sync
+ *  - ping: 0xAA55, LINK_PING, 0, seq (uint32), t1 (uint64, host send time), prev_seq (uint32),
+ *    t4 (uint64, host arrival time of the telemetry frame echoing prev_seq, 0 if none), CRC as above.
+ *    All fields little endian
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_ROS_LINK_H_
+#define INC_ROS_LINK_H_
+
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+
+//Power of 2. At 230400 baud this is over 20ms of data between polls
+#define LINK_RX_SIZE				512
+
+#define LINK_LEGACY_END				0xFFFB
+#define LINK_BATCH_MAGIC			0xAA55
+#define LINK_BATCH_HEADER			8
+#define LINK_BATCH_POINT			6
+#define LINK_BATCH_MAX				32
+
+#define LINK_BATCH_WHEEL			0
+#define LINK_BATCH_CHASSIS			1
+#define LINK_PING					2
+#define LINK_PING_PAYLOAD			20
+#define LINK_BATCH_ABSOLUTE			0x80
+
+//An idle line stamp older than this can not belong to the frame being parsed [us]
+#define LINK_IDLE_MAX_AGE			10000
+
+typedef struct{
+	UART_HandleTypeDef* huart;
+	uint8_t rx[LINK_RX_SIZE];	/*!< DMA target, written circularly >*/
+	uint32_t rd;				/*!< Parser read index, free running >*/
+	uint32_t wr;				/*!< DMA write index at the last poll, free running >*/
+	uint32_t last_frame;		/*!< HAL tick of the last valid frame >*/
+	uint32_t char_time;			/*!< Duration of one character on the line [us] >*/
+	volatile uint32_t idle_stamp;	/*!< Time the line last went idle [us] >*/
+	volatile uint32_t idle_pos;	/*!< Ring position the line went idle at >*/
+	int16_t legacy[2];			/*!< Last legacy command [mm/s] >*/
+	uint32_t frames;			/*!< Valid legacy frames >*/
+	uint32_t batches;			/*!< Valid batch frames >*/
+	uint32_t pings;				/*!< Valid ping frames >*/
+	uint32_t unsynced;			/*!< Absolute batches dropped before the clocks were synchronised >*/
+	uint32_t crc_errors;		/*!< Batch and ping frames failing their CRC >*/
+	uint32_t resyncs;			/*!< Bytes skipped looking for a frame >*/
+	uint32_t restarts;			/*!< DMA restarts after a UART error >*/
+}rosLink_t;
+
+extern rosLink_t ros_link;
+
+/**
+ * \brief Start circular DMA reception and idle line detection
+ * \param [in]      link pointer to link
+ * \param [in]      huart UART connected to ROS, its RX DMA stream must be in circular mode
+ */
+void LINK_Init(rosLink_t* link, UART_HandleTypeDef* huart);
+
+/**
+ * \brief Stamp the end of a burst. Call from the UART interrupt handler before the HAL handler
+ * \param [in]      link pointer to link
+ */
+void LINK_IdleCallback(rosLink_t* link);
+
+/**
+ * \brief Parse everything received since the last poll and queue commands in cmd_buffer.
+ * Restarts reception if a UART error stopped it
+ * \param [in]      link pointer to link
+ * \param [in]      now current TB_Micros64 time [us]
+ * \param [in]      tick current HAL tick [ms]
+ * \return Frames parsed
+ */
+uint32_t LINK_Poll(rosLink_t* link, uint64_t now, uint32_t tick);
+
+#endif /* INC_ROS_LINK_H_ */
@@ -0,0 +1,72 @@
+/*
+ * scheduler.h
+ *
+ * Static cooperative scheduler for the main loop. Tasks are registered at compile time in a const
+ * table, each with a period, a phase offset and a deadline. Jobs never preempt each other: of the
+ * tasks released, the one with the earliest deadline runs to completion next. Runtime and lateness
+ * are kept per task, read them out with the debugger
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_SCHEDULER_H_
+#define INC_SCHEDULER_H_
+
+#include <stdint.h>
+
+#define SCHED_MAX_TASKS			8
+
+typedef struct{
+	const char* name;
+	void (*run)(void);
+	uint32_t period_us;			/*!< Release period [us] >*/
+	uint32_t phase_us;			/*!< First release after SCHED_Start, spreads tasks of one rate [us] >*/
+	uint32_t deadline_us;		/*!< Job must finish this long after its release [us] >*/
+}schedTaskConfig;
+
+typedef struct{
+	uint32_t runs;
+	uint32_t misses;			/*!< Jobs finished after their deadline >*/
+	uint32_t skipped;			/*!< Releases dropped, the task was still waiting for an earlier one >*/
+	uint32_t last_us;			/*!< Runtime of the last job [us] >*/
+	uint32_t max_us;			/*!< Longest job [us] >*/
+	uint64_t total_us;			/*!< Runtime of all jobs [us] >*/
+	uint32_t last_late_us;		/*!< Release to start of the last job [us] >*/
+	uint32_t max_late_us;		/*!< Longest release to start [us] >*/
+}schedStats;
+
+typedef struct{
+	const schedTaskConfig* config;
+	uint32_t release;			/*!< Next release [us] >*/
+	schedStats stats;
+}schedTask;
+
+typedef struct{
+	schedTask tasks[SCHED_MAX_TASKS];
+	uint8_t count;
+	uint32_t start;				/*!< SCHED_Start time [us] >*/
+	uint64_t busy_us;			/*!< Runtime of all jobs since start [us] >*/
+}scheduler_t;
+
+/**
+ * \brief Register the task table, at most SCHED_MAX_TASKS
+ * \param [in]      sched pointer to scheduler
+ * \param [in]      table task table, must outlive the scheduler
+ * \param [in]      count tasks in the table
+ */
+void SCHED_Init(scheduler_t* sched, const schedTaskConfig* table, uint8_t count);
+
+/**
+ * \brief Release every task at its phase from now. Statistics are cleared
+ * \param [in]      sched pointer to scheduler
+ */
+void SCHED_Start(scheduler_t* sched);
+
+/**
+ * \brief Run the released job with the earliest deadline, if any. Call in a loop
+ * \param [in]      sched pointer to scheduler
+ * \return Task that ran, NULL if nothing was due
+ */
+const schedTask* SCHED_Run(scheduler_t* sched);
+
+#endif /* INC_SCHEDULER_H_ */
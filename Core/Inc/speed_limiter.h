@@ -29,9 +29,24 @@ typedef struct{
 }speedConfig;
 
 typedef struct{
-	float v;						/*!< Motor current velocity >*/
-	float v0;						/*!< Previous velocity >*/
-	float v1;						/*!< Previous velocity to v0>*/
+	float v0;						/*!< Velocity at the start of the profile [m/s] >*/
+	float a0;						/*!< Acceleration at the start of the profile [m/s2] >*/
+	float sign;						/*!< +1 when the profile speeds up, -1 when it slows down >*/
+	float jerk;						/*!< Jerk magnitude of the ramps [m/s3] >*/
+	float j1;						/*!< Signed jerk of the first ramp, normalised to a rising profile >*/
+	float a_peak;					/*!< Acceleration held between the ramps, normalised >*/
+	float t1;						/*!< Durations of the ramp, constant acceleration and ramp down phases [s] >*/
+	float t2;
+	float t3;
+	float t;						/*!< Time since the profile started [s] >*/
+}sCurve;
+
+typedef struct{
+	float v;						/*!< In: requested velocity, out: limited velocity [m/s] >*/
+	float a;						/*!< Acceleration of the limited velocity [m/s2] >*/
+	float x;						/*!< Distance covered by the limited velocity [m] >*/
+	float target;					/*!< Target the current profile was planned for [m/s] >*/
+	sCurve profile;					/*!< Jerk limited profile from the planned state to the target >*/
 	float dt;						/*!< Interval between each call of speed limit function>*/
 	uint32_t curr_t;				/*!< Store current time tick>*/
 	uint32_t last_t;				/*!< Store previous time tick>*/
@@ -54,13 +69,34 @@ extern limiter_t angular_limit;
 void SL_Init(limiter_t* limiter, speedConfig* speed_config);
 
 /**
-     * \brief Limit the velocity and acceleration
-     * \param [in, out] v  Velocity [m/s]
-     * \param [in]   limiter pointer to struct that need to be limit
+     * \brief Follow the requested velocity with a time optimal jerk limited (S-curve) profile.
+     * A new profile is planned in closed form from the current velocity and acceleration whenever
+     * the request changes, and evaluated at curr_t
+     * \param [in]   limiter pointer to struct that need to be limit, v holds the request on entry
      * \return Limiting factor (1.0 if none)
      */
 float SL_Limit(limiter_t* limiter);
 
+/**
+ * \brief Plan a time optimal jerk limited profile from a velocity and acceleration to a target
+ * velocity at rest. Ramp the acceleration up, hold it at the limit if it is reached, ramp it down
+ * \param [out]     c profile
+ * \param [in]      v0 starting velocity [m/s]
+ * \param [in]      a0 starting acceleration [m/s2]
+ * \param [in]      target target velocity [m/s]
+ * \param [in]      cfg limits, the jerk magnitude is the smaller of max_jerk and -min_jerk
+ */
+void SL_PlanProfile(sCurve* c, float v0, float a0, float target, const speedConfig* cfg);
+
+/**
+ * \brief Advance a profile and evaluate it in closed form
+ * \param [in]      c profile
+ * \param [in]      dt time step [s]
+ * \param [out]     v velocity [m/s]
+ * \param [out]     a acceleration [m/s2]
+ */
+void SL_StepProfile(sCurve* c, float dt, float* v, float* a);
+
 
 
 #endif /* INC_SPEED_LIMITER_H_ */
@@ -0,0 +1,131 @@
+/*
+ * supervisor.h
+ *
+ * Control loop supervisor. The independent watchdog resets the MCU if the loop stops kicking it,
+ * a SysTick monitor stops the chair well before that if the loop hangs with interrupts still
+ * running, and every tick is timed against a deadline budget. A fault forces the motors to zero
+ * with the brake on. The cause survives the reset in a no-init record for post-mortem
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_SUPERVISOR_H_
+#define INC_SUPERVISOR_H_
+
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+
+//Watchdog timeout. The IWDG runs from the LSI (32kHz nominal, 17-47kHz over temperature), so the
+//real timeout can be off by a factor of 2 either way [ms]
+#define SUP_IWDG_TIMEOUT_MS		50
+//Loop silence after which the SysTick monitor stops the chair [ms]
+#define SUP_HANG_MS				20
+//Execution time budget of one control tick [us]
+#define SUP_TICK_BUDGET_US		900
+//Consecutive overruns that latch a fault
+#define SUP_OVERRUN_LIMIT		10
+//Healthy ticks with no command before a latched fault clears
+#define SUP_RECOVER_TICKS		500
+//Allowance for a flash sector erase and write, covers the worst case of a 128k sector [ms]
+#define SUP_FLASH_STALL_MS		5000
+
+typedef enum{
+	SUP_CAUSE_NONE = 0,
+	SUP_CAUSE_OVERRUN,		//Tick budget exceeded SUP_OVERRUN_LIMIT times in a row
+	SUP_CAUSE_HANG,			//Loop silent for SUP_HANG_MS
+	SUP_CAUSE_ERROR,		//Error_Handler
+	SUP_CAUSE_HARDFAULT,
+	SUP_CAUSE_WATCHDOG,		//IWDG reset with nothing recorded, e.g. interrupts were off
+}supCause;
+
+typedef struct{
+	volatile uint32_t* motor[2];	/*!< Motor PWM compare registers, NULL if driven over serial >*/
+	volatile uint32_t* brake;		/*!< Brake PWM compare register >*/
+	uint32_t motor_neutral;			/*!< Compare value for zero motor output >*/
+	uint32_t brake_engaged;			/*!< Compare value with the brake on >*/
+}supOutputs;
+
+typedef struct{
+	supOutputs outputs;
+	uint8_t armed;					/*!< Watchdog running and loop monitored >*/
+	volatile uint8_t fault;			/*!< Latched cause, SUP_CAUSE_NONE when healthy >*/
+	uint8_t last_reset;				/*!< Cause recorded before the last reset >*/
+	uint8_t reset_flags;			/*!< RCC_CSR reset flags of this boot, bit 0 is BORRSTF >*/
+	uint32_t supervised_resets;		/*!< Resets with a recorded cause since power on >*/
+	volatile uint32_t heartbeat;	/*!< HAL tick of the last tick start >*/
+	volatile uint32_t stall_ms;		/*!< Planned stall in progress, longer silence allowed [ms] >*/
+	uint32_t tick_start;			/*!< Start of the current tick [us] >*/
+	uint32_t last_start;			/*!< Start of the previous tick [us] >*/
+	uint32_t exec_us;				/*!< Execution time of the last tick [us] >*/
+	uint32_t worst_us;				/*!< Longest tick since it was last cleared [us] >*/
+	uint32_t overruns;				/*!< Ticks over budget >*/
+	uint32_t missed;				/*!< Tick periods of 2ms or more, at least one tick skipped >*/
+	uint32_t consecutive;			/*!< Current run of overruns >*/
+	uint32_t healthy;				/*!< Current run of healthy idle ticks while faulted >*/
+}supervisor_t;
+
+extern supervisor_t supervisor;
+
+/**
+ * \brief Read the reset cause and set up the outputs to force on a fault. Does not start the watchdog
+ * \param [in]      sup pointer to supervisor
+ * \param [in]      outputs registers and values of the safe output state
+ */
+void SUP_Init(supervisor_t* sup, const supOutputs* outputs);
+
+/**
+ * \brief Start the watchdog and the loop monitor. The watchdog can not be stopped again
+ * \param [in]      sup pointer to supervisor
+ * \param [in]      tick current HAL tick [ms]
+ */
+void SUP_Start(supervisor_t* sup, uint32_t tick);
+
+/**
+ * \brief Mark the start of a control tick
+ * \param [in]      sup pointer to supervisor
+ * \param [in]      now current time [us]
+ * \param [in]      tick current HAL tick [ms]
+ */
+void SUP_TickBegin(supervisor_t* sup, uint32_t now, uint32_t tick);
+
+/**
+ * \brief Mark the end of a control tick, check it against the budget and kick the watchdog
+ * \param [in]      sup pointer to supervisor
+ * \param [in]      now current time [us]
+ * \param [in]      idle nothing is commanded, a latched fault may clear
+ */
+void SUP_TickEnd(supervisor_t* sup, uint32_t now, uint8_t idle);
+
+/**
+ * \brief Allow the loop to stall, e.g. for a flash write. Lasts until the next SUP_TickEnd
+ * \param [in]      sup pointer to supervisor
+ * \param [in]      ms longest expected stall, at most 8000 [ms]
+ */
+void SUP_Stall(supervisor_t* sup, uint32_t ms);
+
+/**
+ * \brief Check the loop is alive. Call from SysTick
+ * \param [in]      sup pointer to supervisor
+ * \param [in]      tick current HAL tick [ms]
+ */
+void SUP_Monitor(supervisor_t* sup, uint32_t tick);
+
+/**
+ * \brief Force the safe output state and record the cause for after the reset.
+ * Safe to call from fault handlers
+ * \param [in]      cause what went wrong
+ */
+void SUP_Panic(supCause cause);
+
+/**
+ * \brief Write the safe output state
+ * \param [in]      sup pointer to supervisor
+ */
+void SUP_SafeOutputs(const supervisor_t* sup);
+
+static inline uint8_t SUP_Faulted(const supervisor_t* sup)
+{
+	return sup->fault != SUP_CAUSE_NONE;
+}
+
+#endif /* INC_SUPERVISOR_H_ */
@@ -0,0 +1,96 @@
+/*
+ * sysid.h
+ *
+ * Frequency response identification. A stepped sine (discrete chirp) or a multisine is
+ * added to the wheel command and the gain/phase from command to wheel velocity is
+ * computed on the fly with single bin DFT accumulators, so only Bode points leave the MCU.
+ * Tones come from the DDS in wave_lookup.h, so each frequency is exact to fs / 2^32
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_SYSID_H_
+#define INC_SYSID_H_
+
+#include <stdint.h>
+
+#define SYSID_MAX_FREQS			16
+
+//Packet tags sent with USB_Transmit_Cargo. A point is tag, index, then freq, gain and phase
+//as little endian floats. Done is tag and the number of points
+#define SYSID_TAG_POINT			0x42
+#define SYSID_TAG_DONE			0x44
+
+typedef enum{
+	SYSID_CHIRP,			/*!< One frequency at a time, lowest first >*/
+	SYSID_MULTISINE			/*!< All frequencies at once with Schroeder phases >*/
+}sysidType;
+
+typedef struct{
+	sysidType type;
+	float fs;						/*!< Rate SYSID_Step is called at [Hz] >*/
+	float amplitude;				/*!< Peak of the excitation (per tone for the chirp, total for the multisine) >*/
+	float offset;					/*!< Operating point the excitation is added to >*/
+	float settle_time;				/*!< Time left for transients before integrating [s] >*/
+	uint16_t periods;				/*!< Periods of the lowest frequency integrated per point >*/
+	uint16_t num_freqs;
+	float freqs[SYSID_MAX_FREQS];	/*!< [Hz]. For the multisine, integer multiples of freqs[0] >*/
+}sysidConfig;
+
+typedef struct{
+	float freq;						/*!< [Hz] >*/
+	float gain;						/*!< |Y/U| >*/
+	float phase;					/*!< arg(Y/U) [rad] >*/
+}sysidPoint;
+
+typedef struct{
+	sysidConfig cfg;
+	uint8_t active;
+	uint8_t done;
+	uint16_t index;					/*!< Current frequency of the chirp >*/
+	uint32_t n;						/*!< Samples into the current segment >*/
+	uint32_t settle_samples;
+	uint32_t integrate_samples;
+	uint32_t increment[SYSID_MAX_FREQS];	/*!< DDS phase step of each tone >*/
+	uint32_t phase[SYSID_MAX_FREQS];		/*!< DDS phase of each tone >*/
+	uint32_t phase0[SYSID_MAX_FREQS];		/*!< Starting phase of each tone >*/
+	float u_re[SYSID_MAX_FREQS];	/*!< DFT accumulators of the applied command >*/
+	float u_im[SYSID_MAX_FREQS];
+	float y_re[SYSID_MAX_FREQS];	/*!< DFT accumulators of the response >*/
+	float y_im[SYSID_MAX_FREQS];
+	float excitation;				/*!< Last excitation requested, without the offset >*/
+	sysidPoint result[SYSID_MAX_FREQS];
+	uint16_t num_results;
+}sysid_t;
+
+extern sysid_t sysid;
+
+/**
+ * \brief Start a run
+ * \param [in]      id pointer to sysid struct
+ * \param [in]      cfg run configuration, copied
+ */
+void SYSID_Start(sysid_t* id, const sysidConfig* cfg);
+
+/**
+ * \brief Abort a run, the excitation returns to zero
+ * \param [in]      id pointer to sysid struct
+ */
+void SYSID_Stop(sysid_t* id);
+
+/**
+ * \brief Advance one sample
+ * \param [in]      id pointer to sysid struct
+ * \param [in]      u command actually applied during the last sample, after saturation
+ * \param [in]      y measured response to it
+ * \return Command to apply for the next sample (offset plus excitation)
+ */
+float SYSID_Step(sysid_t* id, float u, float y);
+
+/**
+ * \brief Send the next Bode point that has not been sent yet over USB, then the done marker
+ * \param [in]      id pointer to sysid struct
+ */
+void SYSID_Flush(sysid_t* id);
+
+#endif /* INC_SYSID_H_ */
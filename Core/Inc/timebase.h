@@ -0,0 +1,48 @@
+/*
+ * timebase.h
+ *
+ * Free running microsecond counter on TIM5 (32 bit), used to stamp sensor samples
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_TIMEBASE_H_
+#define INC_TIMEBASE_H_
+
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+
+#define TIMEBASE_TIM			TIM5
+
+/**
+ * \brief Start TIM5 counting at 1MHz. Must be called after the clock tree is configured
+ */
+void TB_Init(void);
+
+/**
+ * \brief Current time, wraps around every ~71 minutes
+ * \return Time since TB_Init [us]
+ */
+static inline uint32_t TB_Micros(void)
+{
+	return TIMEBASE_TIM->CNT;
+}
+
+/**
+ * \brief Current time extended to 64 bits. Call from one context only, at least once per wrap
+ * \return Time since TB_Init [us]
+ */
+uint64_t TB_Micros64(void);
+
+/**
+ * \brief Extend a recent 32 bit stamp to 64 bits
+ * \param [in]      stamp TB_Micros stamp, less than one wrap old
+ * \param [in]      now current TB_Micros64 time
+ * \return Stamp on the 64 bit timebase [us]
+ */
+static inline uint64_t TB_Extend(uint32_t stamp, uint64_t now)
+{
+	return now - (uint32_t)((uint32_t)now - stamp);
+}
+
+#endif /* INC_TIMEBASE_H_ */
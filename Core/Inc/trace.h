@@ -0,0 +1,124 @@
+/*
+ * trace.h
+ *
+ * Binary event trace in CCMRAM. Fixed size records stamped with the DWT cycle counter are claimed
+ * with LDREX/STREX, so interrupts and the main loop can log without locking. The ring is not
+ * cleared by the startup code; after a supervised reset it is copied to a post-mortem snapshot
+ * before logging resumes. Both can be dumped over USB, script/TraceDecode.py decodes them
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#ifndef INC_TRACE_H_
+#define INC_TRACE_H_
+
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+
+//Power of 2, 16 bytes each
+#define TRACE_SIZE				1024
+
+//USB cargo tags. The host requests a dump with { TRACE_TAG_REQUEST, source }
+#define TRACE_TAG_REQUEST		0x51
+#define TRACE_TAG_HEADER		0x48
+#define TRACE_TAG_RECORDS		0x52
+#define TRACE_TAG_END			0x45
+#define TRACE_RECORDS_PER_CARGO	14
+
+#define TRACE_SOURCE_LIVE		0
+#define TRACE_SOURCE_SNAPSHOT	1
+
+//Keep in step with EVENTS in script/TraceDecode.py
+typedef enum{
+	TRACE_EV_BOOT = 1,			//a: reset flags | last reset cause << 8, b: boots since power on
+	TRACE_EV_OVERRUN,			//a: tick time [us], b: consecutive overruns
+	TRACE_EV_FAULT,				//a: supervisor cause
+	TRACE_EV_FAULT_CLEAR,
+	TRACE_EV_PANIC,				//a: supervisor cause
+	TRACE_EV_ERROR,				//a: Error_Handler call site
+	TRACE_EV_STALL,				//a: allowed stall [ms]
+	TRACE_EV_SOURCE,			//a: new drive source, b: previous
+	TRACE_EV_ESTOP,				//a: e stop input
+	TRACE_EV_ENCODER,			//a: wheel, b: HAL status | frame << 16. First fault of a run
+	TRACE_EV_LINK_RESTART,		//a: restarts
+	TRACE_EV_LINK_CRC,			//a: CRC errors
+	TRACE_EV_SYNC,				//a: round trip [us], b: offset low 32 bits [us]
+	TRACE_EV_DEADLINE,			//a: scheduler task index, b: release to finish [us]
+}traceEvent;
+
+typedef struct{
+	uint32_t cycles;			/*!< DWT cycle counter >*/
+	uint32_t tag;				/*!< Event id, low 16 bits of the sequence number above. Written last >*/
+	uint32_t a;
+	uint32_t b;
+}traceRecord;
+
+typedef struct{
+	uint32_t magic;
+	volatile uint32_t head;		/*!< Sequence number of the next record, free running >*/
+	volatile uint32_t enabled;
+	uint32_t boots;				/*!< Boots since power on >*/
+	uint32_t core_clock;		/*!< Cycle counter rate [Hz] >*/
+	uint8_t reset_cause;		/*!< Supervisor cause that ended this trace, snapshot only >*/
+	uint8_t reset_flags;		/*!< RCC reset flags of the reset that ended it, snapshot only >*/
+	uint8_t valid;				/*!< Snapshot holds an undumped trace >*/
+	traceRecord rec[TRACE_SIZE];
+}traceRing_t;
+
+typedef struct{
+	traceRing_t* ring;			/*!< Ring being sent, NULL when idle >*/
+	uint8_t source;
+	uint32_t first;				/*!< Sequence number of the first record sent >*/
+	uint32_t count;				/*!< Records to send >*/
+	uint32_t sent;
+	uint8_t header_sent;
+}traceDump_t;
+
+extern traceRing_t trace_ring;
+extern traceRing_t trace_snapshot;
+extern traceDump_t trace_dump;
+
+/**
+ * \brief Start the cycle counter and resume the ring, keeping a post-mortem copy after an abnormal reset
+ * \param [in]      reset_flags RCC reset flags of this boot, see supervisor_t
+ * \param [in]      reset_cause supervisor cause of the last reset
+ */
+void TRACE_Init(uint8_t reset_flags, uint8_t reset_cause);
+
+/**
+ * \brief Log an event. Safe from any context, including fault handlers
+ * \param [in]      id event, see traceEvent
+ * \param [in]      a first argument
+ * \param [in]      b second argument
+ */
+static inline void TRACE_Event(uint32_t id, uint32_t a, uint32_t b)
+{
+	if(!trace_ring.enabled)
+		return;
+	uint32_t cycles = DWT->CYCCNT;
+	uint32_t seq;
+	do{
+		seq = __LDREXW((volatile uint32_t*)&trace_ring.head);
+	}while(__STREXW(seq + 1, (volatile uint32_t*)&trace_ring.head));
+
+	traceRecord* r = &trace_ring.rec[seq & (TRACE_SIZE - 1)];
+	r->cycles = cycles;
+	r->a = a;
+	r->b = b;
+	r->tag = id | seq << 16;
+}
+
+/**
+ * \brief Start sending the live ring or the snapshot over USB. Logging pauses while the live ring is sent
+ * \param [in]      dump pointer to dump state
+ * \param [in]      source TRACE_SOURCE_LIVE or TRACE_SOURCE_SNAPSHOT
+ */
+void TRACE_StartDump(traceDump_t* dump, uint8_t source);
+
+/**
+ * \brief Send the next piece of a dump, one USB cargo per call
+ * \param [in]      dump pointer to dump state
+ */
+void TRACE_Flush(traceDump_t* dump);
+
+#endif /* INC_TRACE_H_ */
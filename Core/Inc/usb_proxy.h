@@ -34,10 +34,13 @@ typedef struct
   USBD_HandleTypeDef*   husbd;
   /*Tx Message*/
   uint8_t              txBuf[256];
+  uint8_t              txFrame[264];     //Framed cargo, read by the USB interrupt until the transfer is done
   /*Rx Message*/
   uint8_t*              buf;
   uint32_t*             len;
   char                  rxMsgRaw[264];
+  uint32_t              rxMsgRawLen;
+  volatile uint8_t      ifNewRxMsg;       //Set by the USB interrupt, cleared once the packet is checked
   uint8_t               msgDetectStage;
   uint8_t               bytesToRead;
   uint8_t               rxMessageCfrm[256];
@@ -67,7 +70,7 @@ typedef struct
 }SendFormat;
 
 void USB_Init(USBD_HandleTypeDef *usb_handler);
-void USB_Transmit_Cargo(uint8_t* buf, uint8_t size);
+uint8_t USB_Transmit_Cargo(uint8_t* buf, uint8_t size);
 void USB_ReceiveCpltCallback(void);
 void USB_Receive_Cargo(void);
 void USB_DataLogInitialization(void);
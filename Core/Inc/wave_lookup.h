@@ -1,6 +1,8 @@
 /*
  * wave_lookup.h
  *
+ * Direct digital synthesis. A 32 bit phase accumulator indexes interpolated tables from
+ * wave_tables.c (script/gen_wave_tables.py), one full turn is 2^32
  *  Created on: 20 Jan 2022
  *      Author: ray
  */
@@ -8,18 +10,74 @@
 #ifndef INC_WAVE_LOOKUP_H_
 #define INC_WAVE_LOOKUP_H_
 
-#include <math.h>
-#include <stdio.h>
+#include <stdint.h>
+#include <wave_tables.h>
 
+//Phase of a quarter turn, adds to a sine phase to give the cosine
+#define DDS_QUARTER_TURN		0x40000000U
 
-#define SINE_ARR_SIZE 40
-#define FOURIER_ARR_SIZE 94
+typedef enum{
+	WAVE_SINE,
+	WAVE_SQUARE,
+	WAVE_TRIANGLE,
+	WAVE_CHIRP,				/*!< Linear sine sweep, restarts after reaching the end frequency >*/
+	WAVE_MULTISINE			/*!< Harmonics listed in wave_tables.h over the base frequency >*/
+}waveType;
 
+typedef struct{
+	waveType type;
+	uint32_t phase;			/*!< Phase accumulator >*/
+	uint32_t increment;		/*!< Phase step per sample, frequency * 2^32 / fs >*/
+	uint32_t inc_start;		/*!< Chirp start increment >*/
+	uint32_t inc_end;		/*!< Chirp end increment >*/
+	int32_t sweep;			/*!< Chirp increment change per sample >*/
+}dds_t;
 
-extern const int sine_table[40];
-extern const int fourier_table[94];
+/**
+ * \brief Set up a periodic waveform
+ * \param [in]      dds pointer to dds struct
+ * \param [in]      type waveform, WAVE_CHIRP is set up with DDS_InitChirp
+ * \param [in]      fs sample rate [Hz]
+ * \param [in]      freq frequency, resolution is fs / 2^32 [Hz]
+ */
+void DDS_Init(dds_t* dds, waveType type, float fs, float freq);
+
+/**
+ * \brief Set up a linear chirp
+ * \param [in]      dds pointer to dds struct
+ * \param [in]      fs sample rate [Hz]
+ * \param [in]      f_start start frequency [Hz]
+ * \param [in]      f_end end frequency [Hz]
+ * \param [in]      duration sweep time [s]
+ */
+void DDS_InitChirp(dds_t* dds, float fs, float f_start, float f_end, float duration);
+
+/**
+ * \brief Phase step for a frequency
+ * \param [in]      fs sample rate [Hz]
+ * \param [in]      freq frequency [Hz]
+ */
+uint32_t DDS_Increment(float fs, float freq);
+
+/**
+ * \brief Next sample
+ * \param [in]      dds pointer to dds struct
+ * \return Sample in Q15
+ */
+int16_t DDS_Step(dds_t* dds);
 
-float sin1(float phase, uint32_t i);
-float fourier(float phase, uint32_t i);
+/**
+ * \brief Interpolated lookup of a table at a phase
+ * \param [in]      table WAVE_TABLE_SIZE + 1 entries
+ * \param [in]      phase phase, a full turn is 2^32
+ * \return Sample in Q15
+ */
+static inline int16_t DDS_Lookup(const int16_t* table, uint32_t phase)
+{
+	uint32_t index = phase >> (32 - WAVE_TABLE_BITS);
+	int32_t frac = (phase >> (32 - WAVE_TABLE_BITS - 15)) & 0x7FFF;
+	int32_t y0 = table[index];
+	return (int16_t)(y0 + (((table[index + 1] - y0) * frac) >> 15));
+}
 
 #endif /* INC_WAVE_LOOKUP_H_ */
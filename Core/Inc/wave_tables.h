@@ -0,0 +1,21 @@
+/*
+ * wave_tables.h
+ *
+ * Generated by script/gen_wave_tables.py, do not edit
+ */
+
+#ifndef INC_WAVE_TABLES_H_
+#define INC_WAVE_TABLES_H_
+
+#include <stdint.h>
+
+#define WAVE_TABLE_BITS			8
+#define WAVE_TABLE_SIZE			(1 << WAVE_TABLE_BITS)
+
+//Harmonics in the multisine table: 1, 2, 4, 8
+#define WAVE_MULTISINE_TONES	4
+
+extern const int16_t wave_sine_table[WAVE_TABLE_SIZE + 1];
+extern const int16_t wave_multisine_table[WAVE_TABLE_SIZE + 1];
+
+#endif /* INC_WAVE_TABLES_H_ */
@@ -35,6 +35,27 @@
 #include <usb_proxy.h>
 #include <wave_lookup.h>
 #include <speed_limiter.h>
+#include <odometry.h>
+#include <timebase.h>
+#include <attitude.h>
+#include <imu_calib.h>
+#include <biquad.h>
+#include <joystick.h>
+#include <drive_mode.h>
+#include <feedforward.h>
+#include <sysid.h>
+#include <autotune.h>
+#include <gain_schedule.h>
+#include <pid_batch.h>
+#include <kinematic_limiter.h>
+#include <cmd_buffer.h>
+#include <ros_link.h>
+#include <clock_sync.h>
+#include <supervisor.h>
+#include <trace.h>
+#include <mem_sections.h>
+#include <clock_profile.h>
+#include <scheduler.h>
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -72,6 +93,42 @@
 #define CX_CONTROL 1
 #define BY_CONTROL 0
 
+//Clock tree, see clock_profile.h. CLK_PROFILE_MAX has no 48MHz for USB, the USB device is not started
+#define CLOCK_PROFILE		CLK_PROFILE_PERFORMANCE
+
+//Task rates of the scheduler, the control tick runs at FREQUENCY. The IMU is polled a little faster
+//than IMU_ODR_HZ so no sample is lost to drift between the IMU and MCU clocks. Telemetry frames take
+//about 5ms on the ROS UART, keep TELEMETRY_HZ under 190
+#define IMU_POLL_HZ			2000
+#define TELEMETRY_HZ		100
+#define SABERTOOTH_POLL_HZ	50
+
+//Signal filters. IMU low pass matches the time constant of the old exponential filter
+#define IMU_LPF_HZ			35.0f
+#define VEL_FILTER_TYPE		BQ_PASS
+#define VEL_LPF_HZ			50.0f
+
+//Define to measure the biquad cost with the DWT cycle counter at start up
+//#define FILTER_BENCHMARK
+
+//Define to compare the batched wheel PIDs against PID_getOutput at start up
+//#define PID_BENCHMARK
+
+//Define to time every control tick with the cycle counter, for comparing memory placements
+//(see mem_sections.h). Ticks with a planned flash stall are left out
+//#define LOOP_BENCHMARK
+#define LOOP_HIST_BIN_US	25
+#define LOOP_HIST_BINS		40
+
+//Define to run frequency response identification instead of the controllers, chair on stands.
+//Bode points are sent over USB, see sysid.h
+//#define SYSID_MODE
+
+//Define to run a relay autotune of both wheel loops instead of the controllers, chair on stands.
+//Gains are sent over USB and stored in flash, they are loaded at boot by the normal build
+//#define AUTOTUNE_MODE
+#define AUTOTUNE_RULE		AT_RULE_ZN_PI
+
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -87,6 +144,7 @@ SPI_HandleTypeDef hspi1;
 SPI_HandleTypeDef hspi4;
 SPI_HandleTypeDef hspi6;
 
+TIM_HandleTypeDef htim2;
 TIM_HandleTypeDef htim4;
 
 UART_HandleTypeDef huart4;
@@ -101,39 +159,76 @@ USBProxyHandler hUSB;
 CRC_HandleTypeDef hcrc;
 
 /* USER CODE BEGIN PV */
+//Control state read and written every tick is marked for CCMRAM, off the bus DMA uses, with
+//CCMRAM_HOT_DATA in mem_sections.h. DMA buffers (data_to_ros, motor_receive_buf, the ROS link and
+//joystick rings) must stay in SRAM
+
 //Variables to store raw data from various sensors and uart
-uint32_t joystick_raw;
-int16_t acc[3], gyro[3];
+CCMRAM_BSS int16_t acc[3], gyro[3];
+CCMRAM_BSS float acc_si[3], gyro_si[3];
+
+//Filter banks, IMU axes are gyro x,y,z then acc x,y,z
+CCMRAM_BSS biquadFilter imu_filter[6];
+CCMRAM_BSS biquadFilter velocity_filter[2];
+float biquad_cycles_per_sample;
+float pid_scalar_cycles, pid_batch_cycles;
+#ifdef LOOP_BENCHMARK
+//Read them out with the debugger, the last bin also counts everything longer
+uint32_t loop_cycles_worst, loop_ticks;
+uint64_t loop_cycles_total;
+uint32_t loop_hist[LOOP_HIST_BINS];
+#endif
 uint16_t encoder[2];
-uint8_t data_from_ros_raw[SIZE_DATA_FROM_ROS] = { 0 };
+uint32_t imu_stamp = 0; //Time of the last IMU sample [us]
+scheduler_t scheduler;
 
 uint16_t e_stop = 1;
 
 //Variables to store processed data
-uint16_t joystick[2];
-double joystick_filter = 0.025;
-double velocity[2];
-int16_t data_from_ros[SIZE_DATA_FROM_ROS / 2];
+CCMRAM_BSS double velocity[2];
 
-int16_t motor_command[2] = { 0 };
+CCMRAM_BSS int16_t motor_command[2];
 uint16_t data_to_ros[SIZE_DATA_TO_ROS] = { 0 };
 uint8_t braked = 1; //Stores the brake status of left and right motors
 double filtered_setpoint[2] = { 0 };
-double setpoint_vel[2];
+CCMRAM_BSS double setpoint_vel[2];
 uint32_t brake_timer = 0;
-uint32_t prev_uart_time = 0;
 double engage_brakes_timeout = 5; //5s
-double angular_output = 0;
-//Velocity stuff
-double target_heading, curr_heading;
 
 //PID struct and their tunings. There's one PID controller for each motor
-PID_Struct left_pid, right_pid, left_ramp_pid, right_ramp_pid, left_d_ramp_pid,
-		right_d_ramp_pid;
+CCMRAM_BSS PID_Struct left_pid, right_pid, yaw_pid;
+//Speed scheduled gains and ramp limits of the wheel PIDs
+CCMRAM_BSS gainSchedule_t left_schedule, right_schedule;
+//CX wheel PIDs stepped together, tuned through left_pid and right_pid
+CCMRAM_BSS pidBatch_t wheel_pids;
+uint32_t wheel_pid_time = 0;
 #if BY_CONTROL
 double p = 0.0, i = 100.0 * SCALING, d = 0.0, f = 340 * SCALING, max_i_output =
 		40 * SCALING;
 double pid_freq = 500;
+//Yaw rate loop, output is a correction to the commanded yaw rate [rad/s]
+double yaw_p = 0.8, yaw_i = 2.0, max_yaw_correction = 0.5;
+
+//Wheel output ramp limits against speed. Starting from and stopping to standstill matches what
+//the ramp rate PIDs used to produce, base rate plus their P gain times the speed
+const gsPoint accel_schedule[] = {
+		{ 0.0, 1.0, 1.0, 100 * SCALING, 150 * SCALING },
+		{ 0.5, 1.0, 1.0, 150 * SCALING, 150 * SCALING },
+		{ 1.0, 1.0, 1.0, 200 * SCALING, 150 * SCALING },
+		{ 1.5, 1.0, 1.0, 250 * SCALING, 150 * SCALING }
+};
+const gsPoint left_decel_schedule[] = {
+		{ 0.0, 1.0, 1.0, 100 * SCALING, 150 * SCALING },
+		{ 0.5, 1.0, 1.0, 100 * SCALING, 225 * SCALING },
+		{ 1.0, 1.0, 1.0, 100 * SCALING, 300 * SCALING },
+		{ 1.5, 1.0, 1.0, 100 * SCALING, 375 * SCALING }
+};
+const gsPoint right_decel_schedule[] = {
+		{ 0.0, 1.0, 1.0, 100 * SCALING, 150 * SCALING },
+		{ 0.5, 1.0, 1.0, 100 * SCALING, 200 * SCALING },
+		{ 1.0, 1.0, 1.0, 100 * SCALING, 250 * SCALING },
+		{ 1.5, 1.0, 1.0, 100 * SCALING, 300 * SCALING }
+};
 #endif
 
 #if CX_CONTROL
@@ -157,13 +252,21 @@ speedConfig angular_speed_config = {
 		.max_jerk = 2.5,
 		.min_jerk = -2.5
 };
-limiter_t linear_limit;
-limiter_t angular_limit;
+//Axis and wheel limits of the chassis command. Linear and angular are scaled together and follow
+//one shared profile, so each is held to the tighter of its own limits and the wheel limits
+const kinematicConfig kinematic_config = {
+		.base_width = BASE_WIDTH,
+		.max_wheel_vel = 1.2,
+		.max_wheel_acc = 1.0,
+		.linear = &linear_speed_config,
+		.angular = &angular_speed_config
+};
+CCMRAM_BSS kinematicLimiter_t kinematic_limit;
+CCMRAM_BSS float cmd_linear, cmd_angular;
 
 
-//Feedforward outputs from experimental data, at x speed, what feedforward factor is required
-//0.1 = 500, 0.2 = 450, 0.5 = 350, 0.7 = 320, 0.9 = 320
-//Feedforward equation to line fit = y=290(x-0.9)^2 + 310
+//Feedforward gains come from tables generated from the characterisation data in
+//script/feedforward.csv, see feedforward.h
 
 //Data logging
 Sabertooth_Handler sabertooth_handler;
@@ -173,11 +276,36 @@ double angular_velocity[2];
 uint32_t prev_st_uart_time = 0;
 char str[256];
 
-float tick_count = 0;
-float v = 0;
-float v_i = 25.2;
-static int count = 1;
-int sine_counter = 0;
+#ifdef SYSID_MODE
+//Voltage to wheel velocity around a 6V operating point. Multisine tones are multiples of 0.5Hz
+sysidConfig sysid_config = {
+		.type = SYSID_MULTISINE,
+		.fs = FREQUENCY,
+		.amplitude = 4.0,
+		.offset = 6.0,
+		.settle_time = 2.0,
+		.periods = 4,
+		.num_freqs = 10,
+		.freqs = { 0.5, 1.0, 1.5, 2.0, 3.0, 4.0, 6.0, 8.0, 12.0, 16.0 }
+};
+float sysid_volts = 0;
+float sysid_applied = 0; //Voltage the motors got last tick, after the fault hold and saturation
+uint8_t sysid_started = 0;
+#endif
+
+#ifdef AUTOTUNE_MODE
+//Relay around a mid speed, amplitude in the controller output units (volts for CX, counts for BY)
+atConfig autotune_config = {
+		.setpoint = 0.5,
+		.amplitude = BY_CONTROL ? 60 * SCALING : 2.0,
+		.hysteresis = 0.02,
+		.discard_cycles = 3,
+		.measure_cycles = 5,
+		.timeout = 20000
+};
+autotune_t autotune[2];
+uint8_t autotune_started = 0, autotune_finished = 0, autotune_reported = 0;
+#endif
 
 /* USER CODE END PV */
 
@@ -185,6 +313,7 @@ int sine_counter = 0;
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
 static void MX_DMA_Init(void);
+static void MX_TIM2_Init(void);
 static void MX_TIM4_Init(void);
 static void MX_ADC1_Init(void);
 static void MX_SPI1_Init(void);
@@ -194,12 +323,33 @@ static void MX_SPI4_Init(void);
 static void MX_UART4_Init(void);
 static void MX_CRC_Init(void);
 /* USER CODE BEGIN PFP */
+static void imuTask(void);
+static void sensorTask(void);
+static void hostCommandTask(void);
+static void limiterTask(void);
+static void controlTask(void);
+static void controlTickTask(void);
+static void logTask(void);
+static void telemetryTask(void);
+#ifdef SERIAL_CONTROL
+static void sabertoothTask(void);
+#endif
 void setBrakes();
+void packInt32(uint16_t *dst, int32_t value);
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
-
+//Phases spread the releases of each millisecond
+static const schedTaskConfig task_table[] = {
+	{ "control", controlTickTask, 1000000 / FREQUENCY, 0, 1000000 / FREQUENCY },
+	{ "imu", imuTask, 1000000 / IMU_POLL_HZ, 250, 1000000 / IMU_POLL_HZ },
+	{ "log", logTask, 1000000 / FREQUENCY, 500, 1000000 / FREQUENCY },
+	{ "telemetry", telemetryTask, 1000000 / TELEMETRY_HZ, 700, 2000 },
+#ifdef SERIAL_CONTROL
+	{ "sabertooth", sabertoothTask, 1000000 / SABERTOOTH_POLL_HZ, 300, 10000 },
+#endif
+};
 /* USER CODE END 0 */
 
 /**
@@ -237,13 +387,18 @@ int main(void) {
 	MX_GPIO_Init();
 	MX_DMA_Init();
 	MX_TIM4_Init();
+	MX_TIM2_Init();
 	MX_ADC1_Init();
 	MX_SPI1_Init();
 	MX_USART2_UART_Init();
 	MX_SPI6_Init();
 	MX_SPI4_Init();
 	MX_UART4_Init();
-	MX_USB_DEVICE_Init();
+	//The proxy takes the handle first, a request can arrive as soon as the device enumerates
+	if (CLK_UsbClockValid()) {
+		USB_Init(&hUsbDeviceFS);
+		MX_USB_DEVICE_Init();
+	}
 	MX_CRC_Init();
 	/* USER CODE BEGIN 2 */
 //  DWT_Init();
@@ -265,30 +420,65 @@ int main(void) {
 //  //Engage brakes
 	BRAKE_TIM.Instance->BRAKE_CHANNEL = 1000;
 	MotorInit(&sabertooth_handler, 128, &huart4);
+
+	//Outputs the supervisor forces on a fault, motors over serial can only be stopped from the loop
+	supOutputs safe_outputs = {
+#ifndef SERIAL_CONTROL
+			.motor = { &MOTOR_TIM.Instance->LEFT_MOTOR_CHANNEL, &MOTOR_TIM.Instance->RIGHT_MOTOR_CHANNEL },
+#endif
+			.brake = &BRAKE_TIM.Instance->BRAKE_CHANNEL,
+			.motor_neutral = 1500,
+			.brake_engaged = 1000,
+	};
+	SUP_Init(&supervisor, &safe_outputs);
+	TRACE_Init(supervisor.reset_flags, supervisor.last_reset);
 //  PowerOff(&sabertooth_handler);
 
 	//Initialize IMU, check that it is connected
 	IMU_Init();
+	TB_Init();
+	CALIB_Init(&imu_calib);
+	ATT_Init(&attitude, ATT_KP, ATT_KI);
+
+	//Second IMU stage is spare for a vibration notch, e.g. BQ_Configure(&imu_filter[i], 1, BQ_NOTCH, ...)
+	for (int i = 0; i < 6; ++i) {
+		BQ_Init(&imu_filter[i], 2);
+		BQ_Configure(&imu_filter[i], 0, BQ_LOWPASS, IMU_ODR_HZ, IMU_LPF_HZ, 0.7071f);
+	}
+	for (int i = 0; i < 2; ++i) {
+		BQ_Init(&velocity_filter[i], 1);
+		BQ_Configure(&velocity_filter[i], 0, VEL_FILTER_TYPE, FREQUENCY, VEL_LPF_HZ, 0.7071f);
+	}
+
+#ifdef FILTER_BENCHMARK
+	{
+		static float bench_buf[64];
+		biquadFilter bench;
+		BQ_Init(&bench, 2);
+		BQ_Configure(&bench, 0, BQ_LOWPASS, IMU_ODR_HZ, IMU_LPF_HZ, 0.7071f);
+		BQ_Configure(&bench, 1, BQ_NOTCH, IMU_ODR_HZ, 200.0f, 5.0f);
+		DWT_Init();
+		//Per sample cost of a 2 stage cascade, read it out with the debugger
+		biquad_cycles_per_sample = BQ_Benchmark(&bench, bench_buf, 64);
+	}
+#endif
 
 //  HAL_UART_Receive_DMA(&SABERTOOTH_UART, motor_receive_buf, sizeof(motor_receive_buf));
 //  MotorReadBattery(&sabertooth_handler);
 	//Initialize BNO055
 //  BNO055Init();
 //	MotorReadBattery(&sabertooth_handler);
-	//Start UART output
-	HAL_UART_Transmit_DMA(&ROS_UART, (uint8_t*) data_to_ros,
-			(uint16_t) SIZE_DATA_TO_ROS * 2);
-	HAL_UART_Receive_DMA(&ROS_UART, data_from_ros_raw, SIZE_DATA_FROM_ROS);
+	CMD_Init(&cmd_buffer);
+	SYNC_Init(&clock_sync);
+	LINK_Init(&ros_link, &ROS_UART);
 
+#if defined(USB_ACTIVATE) || defined(SYSID_MODE) || defined(AUTOTUNE_MODE)
+	_Static_assert(CLOCK_PROFILE != CLK_PROFILE_MAX, "USB output needs a clock profile with USB at 48MHz");
+#endif
 #ifdef USB_ACTIVATE
-	USB_Init(&hUsbDeviceFS);
 	USB_DataLogStart();
 #endif
 	//********* WHEEL PID *********//
-	double base_left_ramp_rate = 100 * SCALING;
-	double base_right_ramp_rate = 100 * SCALING;
-	double base_left_d_ramp_rate = 150 * SCALING;
-	double base_right_d_ramp_rate = 150 * SCALING;
 #if BY_CONTROL == 1
 	//Setup right wheel PID
 	PID_Init(&right_pid);
@@ -296,8 +486,6 @@ int main(void) {
 	PID_setMaxIOutput(&right_pid, max_i_output);
 	PID_setOutputLimits(&right_pid, -500 * SCALING, 500 * SCALING);
 	PID_setFrequency(&right_pid, pid_freq);
-	PID_setOutputRampRate(&right_pid, base_right_ramp_rate);
-	PID_setOutputDescentRate(&right_pid, -base_right_d_ramp_rate);
 
 	//Setup left wheel PID
 	PID_Init(&left_pid);
@@ -305,50 +493,13 @@ int main(void) {
 	PID_setMaxIOutput(&left_pid, max_i_output);
 	PID_setOutputLimits(&left_pid, -500 * SCALING, 500 * SCALING);
 	PID_setFrequency(&left_pid, pid_freq);
-	PID_setOutputRampRate(&left_pid, base_left_ramp_rate);
-	PID_setOutputDescentRate(&left_pid, -base_left_d_ramp_rate);
-
-	//********* WHEEL ACCEL RAMP PID *********//
-	double right_ramp_p = 100 * SCALING;
-	double left_ramp_p = 100 * SCALING;
-	double max_ramp_rate_inc = 300 * SCALING;
-	//Setup right wheel ramp PID
-	PID_Init(&right_ramp_pid);
-	PID_setPIDF(&right_ramp_pid, right_ramp_p, 0, 0, 0);
-	PID_setOutputLimits(&right_ramp_pid, 0, 400 * SCALING);
-	PID_setOutputRampRate(&right_ramp_pid, max_ramp_rate_inc);
-	PID_setOutputDescentRate(&right_ramp_pid, -max_ramp_rate_inc);
-	PID_setFrequency(&right_ramp_pid, pid_freq);
-
-	//Setup left wheel ramp PID
-	PID_Init(&left_ramp_pid);
-	PID_setPIDF(&left_ramp_pid, left_ramp_p, 0, 0, 0);
-	PID_setOutputLimits(&left_ramp_pid, 0, 400 * SCALING);
-	PID_setOutputRampRate(&left_ramp_pid, max_ramp_rate_inc);
-	PID_setOutputDescentRate(&left_ramp_pid, -max_ramp_rate_inc);
-	PID_setFrequency(&left_ramp_pid, pid_freq);
-
-	//********* WHEEL DECEL RAMP PID *********//
-	double right_d_ramp_p = 100 * SCALING;
-	double left_d_ramp_p = 150 * SCALING;
-	double right_max_d_ramp_rate_inc = 200 * SCALING;
-	double left_max_d_ramp_rate_inc = 200 * SCALING;
-	double max_d_increase = 550 * SCALING;
-	//Setup right wheel d ramp PID
-	PID_Init(&right_d_ramp_pid);
-	PID_setPIDF(&right_d_ramp_pid, right_d_ramp_p, 0, 0, 0);
-	PID_setOutputLimits(&right_d_ramp_pid, 0, max_d_increase);
-	PID_setOutputRampRate(&right_d_ramp_pid, right_max_d_ramp_rate_inc);
-	PID_setOutputDescentRate(&right_d_ramp_pid, -right_max_d_ramp_rate_inc);
-	PID_setFrequency(&right_d_ramp_pid, pid_freq);
-
-	//Setup left wheel d ramp PID
-	PID_Init(&left_d_ramp_pid);
-	PID_setPIDF(&left_d_ramp_pid, left_d_ramp_p, 0, 0, 0);
-	PID_setOutputLimits(&left_d_ramp_pid, 0, max_d_increase);
-	PID_setOutputRampRate(&left_d_ramp_pid, left_max_d_ramp_rate_inc);
-	PID_setOutputDescentRate(&left_d_ramp_pid, -left_max_d_ramp_rate_inc);
-	PID_setFrequency(&left_d_ramp_pid, pid_freq);
+
+	//********* YAW RATE PID *********//
+	PID_Init(&yaw_pid);
+	PID_setPID(&yaw_pid, yaw_p, yaw_i, 0);
+	PID_setOutputLimits(&yaw_pid, -max_yaw_correction, max_yaw_correction);
+	PID_setMaxIOutput(&yaw_pid, max_yaw_correction);
+	PID_setFrequency(&yaw_pid, pid_freq);
 #endif
 
 #if CX_CONTROL == 1
@@ -369,321 +520,56 @@ int main(void) {
 	PID_setFrequency(&left_pid, pid_freq);
 #endif
 
-	SL_Init(&linear_limit, &linear_speed_config);
-	SL_Init(&angular_limit, &angular_speed_config);
+	KL_Init(&kinematic_limit, &kinematic_config);
+	DRIVE_Init(&drive);
+	FF_Init(BY_CONTROL ? FF_BY : FF_CX);
+
+	//Gains from a previous autotune run replace the hand tuned ones, F stays with the feedforward
+	wheelGains stored_gains;
+	if (AT_Load(&stored_gains, BY_CONTROL ? FF_BY : FF_CX)) {
+		PID_setPID(&left_pid, stored_gains.p[LEFT_INDEX],
+				stored_gains.i[LEFT_INDEX], stored_gains.d[LEFT_INDEX]);
+		PID_setPID(&right_pid, stored_gains.p[RIGHT_INDEX],
+				stored_gains.i[RIGHT_INDEX], stored_gains.d[RIGHT_INDEX]);
+	}
+#if BY_CONTROL
+	//Scheduled gains scale whichever P and I were just loaded
+	GS_Init(&left_schedule,
+			&(gsTable){ accel_schedule, sizeof(accel_schedule) / sizeof(gsPoint) },
+			&(gsTable){ left_decel_schedule, sizeof(left_decel_schedule) / sizeof(gsPoint) },
+			left_pid.P, left_pid.I);
+	GS_Init(&right_schedule,
+			&(gsTable){ accel_schedule, sizeof(accel_schedule) / sizeof(gsPoint) },
+			&(gsTable){ right_decel_schedule, sizeof(right_decel_schedule) / sizeof(gsPoint) },
+			right_pid.P, right_pid.I);
+#endif
+	PIDB_Init(&wheel_pids);
+	PIDB_Load(&wheel_pids, LEFT_INDEX, &left_pid);
+	PIDB_Load(&wheel_pids, RIGHT_INDEX, &right_pid);
+	wheel_pid_time = HAL_GetTick();
+#ifdef PID_BENCHMARK
+	{
+		PID_Struct bench_pids[2] = { left_pid, right_pid };
+		DWT_Init();
+		//Cycles per step of both wheels, read them out with the debugger
+		pid_batch_cycles = PIDB_Benchmark(&wheel_pids, bench_pids, 256,
+				&pid_scalar_cycles);
+	}
+#endif
 
+	ODOM_Init(&odometry);
 
 	/* USER CODE END 2 */
 
 	/* Infinite loop */
 	/* USER CODE BEGIN WHILE */
-	uint32_t prev_time = HAL_GetTick();
-	uint32_t wave_prev_time = HAL_GetTick();
+	//Every job runs from the scheduler, see task_table. Telemetry to ROS starts with its first release
+	imu_stamp = TB_Micros();
+	SCHED_Init(&scheduler, task_table, sizeof(task_table) / sizeof(schedTaskConfig));
+	SUP_Start(&supervisor, HAL_GetTick());
+	SCHED_Start(&scheduler);
 	while (1) {
-		//Loop should execute once every 1 tick
-		if (HAL_GetTick() - prev_time >= 1) {
-			imuRead(acc, gyro, 0.2);
-			encoderRead(encoder);
-			calcVelFromEncoder(encoder, velocity);
-			e_stop = HAL_GPIO_ReadPin(GPIOB, GPIO_PIN_12);
-
-			//For data logging
-			angular_velocity[LEFT_INDEX] = velocity[LEFT_INDEX];
-			angular_velocity[RIGHT_INDEX] = velocity[RIGHT_INDEX];
-
-			//Wave generator
-			//If e st
-			//Square wave
-//			if (tick_count <= 2500){
-//			  v = 12;
-//			}
-//			else{
-//			  v = -12;
-//			}
-//			tick_count++;
-//			if (tick_count >5000)
-//				  tick_count = 0;
-
-
-//			int sampling_rate = 1000;
-//			//generate sine wave
-//			if (HAL_GetTick() - wave_prev_time > 1)
-//			{
-////				float x = SINE_ARR_SIZE * 0.001 * (float)tick_count;
-////				v =  sin1(x, (tick_count++))/32767;
-//
-////				float x = FOURIER_ARR_SIZE * 0.001 * (float)tick_count;
-////				v = 12 * fourier(x, (tick_count++))/65536;
-//
-////				v = 0.4 * (sin(2 * M_PI * 0.1 * tick_count/sampling_rate) + sin(2 * M_PI * 0.2 * tick_count/sampling_rate)
-////											+ sin(2 * M_PI * 0.4 * tick_count/sampling_rate) + sin(2 * M_PI * tick_count/sampling_rate));
-//				int prev_v = v;
-//				v = 1 * sin(2 * M_PI * tick_count/sampling_rate);
-////				if (v>1 || v <-1)
-////					v = prev_v;
-//				tick_count++;
-//				wave_prev_time = HAL_GetTick();
-//			}
-	 if((uint16_t)data_from_ros[SIZE_DATA_FROM_ROS / 2 - 1] == 0xFFFB)
-			  {
-				  //Data received from ros is integer format, multiplied by 1000
-				  setpoint_vel[LEFT_INDEX] = (double)data_from_ros[0] / 1000.0;
-				  setpoint_vel[RIGHT_INDEX] = (double)data_from_ros[1] / 1000.0;
-
-			//If e stop engaged, override setpoints to 0
-			if (e_stop == 1) {
-				v = 0;
-			}
-
-			//use speed from data_from_ros array, pass on to motors, ensure the data is valid by checking end bit
-			if (BY_CONTROL) {
-				//Heading is synonymous to radius of curvature for given velocity pair
-				double target_angular = (setpoint_vel[RIGHT_INDEX]
-						- setpoint_vel[LEFT_INDEX]);
-				double curr_angular = (velocity[RIGHT_INDEX]
-						- velocity[LEFT_INDEX]);
-				double target_linear = (setpoint_vel[RIGHT_INDEX]
-						+ setpoint_vel[LEFT_INDEX]) / 2.0;
-				double curr_linear = (velocity[RIGHT_INDEX]
-						+ velocity[LEFT_INDEX]) / 2.0;
-				target_heading = atan2(target_linear, target_angular);
-				curr_heading = atan2(curr_linear, curr_angular);
-
-				//This case might happen when curr_heading is M_PI and target_heading is -M_PI
-				//In this case, both values should be equal signs
-				if (target_heading == M_PI || curr_heading == M_PI) {
-					curr_heading = fabs(curr_heading);
-					target_heading = fabs(target_heading);
-				}
-
-				//When angular_output negative, right wheel is slower
-				//When angular_output positive, left wheel is slower
-				double new_angular_output = (target_heading - curr_heading)
-						/ M_PI;
-				int sign = new_angular_output / fabs(new_angular_output);
-
-				//Sigmoid curve to make new_angular_output more sensitive in mid range (~0.5)
-				//~0.5 is max value that occurs when going from pure rotation to pure forward
-				new_angular_output = 1
-						/ (1 + exp(-15 * (fabs(new_angular_output) - 0.35)))
-						* sign;
-
-				//Small velocities cause large changes to heading due to noise
-				//Set difference to 0 if below threshold, no correction
-				if (fabs(velocity[LEFT_INDEX]) < 0.1
-						&& fabs(velocity[RIGHT_INDEX]) < 0.1)
-					new_angular_output = 0;
-
-				double angular_output_filt = 0.0;
-				angular_output = angular_output_filt * (angular_output)
-						+ (1 - angular_output_filt) * new_angular_output;
-				//Amount of penalty to setpoint depends on how far away from the target heading
-				//Scale may increase over 100%, but does not matter as the heading approaches target heading
-				//scale will approach 100%
-				if (setpoint_vel[LEFT_INDEX] != 0.0
-						|| setpoint_vel[RIGHT_INDEX] != 0.0) {
-					setpoint_vel[LEFT_INDEX] *= (1 + angular_output);
-					setpoint_vel[RIGHT_INDEX] *= (1 - angular_output);
-				}
-
-				/**
-				 * Motor FEEDFORWARD params
-				 */
-				double f_left = 290
-						* pow(fabs(setpoint_vel[LEFT_INDEX]) - 0.9, 2) + 310;
-				double f_right = 290
-						* pow(fabs(setpoint_vel[RIGHT_INDEX]) - 0.9, 2) + 310;
-
-				//Upper bound on feedforward equation
-				if (setpoint_vel[LEFT_INDEX] > 1.0)
-					f_left = 310;
-				if (setpoint_vel[RIGHT_INDEX] > 1.0)
-					f_right = 310;
-
-				f_left = f_left * SCALING;
-				f_right = f_right * SCALING;
-				PID_setF(&left_pid, f_left);
-				PID_setF(&right_pid, f_right);
-
-				//If e stop engaged, override setpoints to 0
-				if (e_stop == 1) {
-					setpoint_vel[LEFT_INDEX] = 0;
-					setpoint_vel[RIGHT_INDEX] = 0;
-				}
-
-				//If data is old, set setpoint to 0
-				else if ((HAL_GetTick() - prev_uart_time) > FREQUENCY * 0.2) {
-//					setpoint_vel[LEFT_INDEX] = 0;
-//					setpoint_vel[RIGHT_INDEX] = 0;
-					HAL_UART_Receive_DMA(&ROS_UART, data_from_ros_raw,
-							SIZE_DATA_FROM_ROS);
-				}
-//					else if ((HAL_GetTick() - prev_st_uart_time)
-//						> FREQUENCY * 0.005) {
-////					MotorReadBattery(&sabertooth_handler);
-//				}
-
-				//Unbrake motors if there is command, brake otherwise
-				setBrakes();
-
-				//Ensure there is a commanded velocity, otherwise reset PID
-				if (fabs(setpoint_vel[LEFT_INDEX]) == 0
-						&& fabs(velocity[LEFT_INDEX]) < 0.05) {
-					motor_command[LEFT_INDEX] = 0;
-					PID_reset(&left_pid);
-				}
-
-				else if (!braked) {
-					//ACCELERATE
-					{
-						double new_left_ramp = base_left_ramp_rate
-								+ PID_getOutput(&left_ramp_pid,
-										fabs(velocity[LEFT_INDEX]),
-										fabs(setpoint_vel[LEFT_INDEX]));
-						PID_setOutputRampRate(&left_pid, new_left_ramp);
-					}
-
-					//DECELERATE
-					{
-						double new_left_ramp = base_left_d_ramp_rate
-								+ PID_getOutput(&left_d_ramp_pid,
-										fabs(setpoint_vel[LEFT_INDEX]),
-										fabs(velocity[LEFT_INDEX]));
-						PID_setOutputDescentRate(&left_pid, -new_left_ramp);
-					}
-
-					motor_command[LEFT_INDEX] = PID_getOutput(&left_pid,
-							velocity[LEFT_INDEX], setpoint_vel[LEFT_INDEX]);
-				}
-
-				//Ensure there is a commanded velocity, otherwise reset PID
-				if (fabs(setpoint_vel[RIGHT_INDEX]) == 0
-						&& fabs(velocity[RIGHT_INDEX]) < 0.05) {
-					motor_command[RIGHT_INDEX] = 0;
-					PID_reset(&right_pid);
-				}
-
-				else if (!braked) {
-
-					//ACCELERATE
-					{
-						double new_right_ramp = base_right_ramp_rate
-								+ PID_getOutput(&right_ramp_pid,
-										fabs(velocity[RIGHT_INDEX]),
-										fabs(setpoint_vel[RIGHT_INDEX]));
-						PID_setOutputRampRate(&right_pid, new_right_ramp);
-					}
-
-					//DECELERATE
-					{
-						double new_right_ramp = base_right_d_ramp_rate
-								+ PID_getOutput(&right_d_ramp_pid,
-										fabs(setpoint_vel[RIGHT_INDEX]),
-										fabs(velocity[RIGHT_INDEX]));
-						PID_setOutputDescentRate(&right_pid, -new_right_ramp);
-					}
-
-					motor_command[RIGHT_INDEX] = PID_getOutput(&right_pid,
-							velocity[RIGHT_INDEX], setpoint_vel[RIGHT_INDEX]);
-				}
-
-				//Send PID commands to motor
-#ifndef SERIAL_CONTROL
-
-				MOTOR_TIM.Instance->RIGHT_MOTOR_CHANNEL =
-						motor_command[LEFT_INDEX] + 1500;
-				MOTOR_TIM.Instance->LEFT_MOTOR_CHANNEL =
-						motor_command[RIGHT_INDEX] + 1500;
-#else
-				  MotorThrottle(&sabertooth_handler, LEFT_INDEX+1, motor_command[LEFT_INDEX]);
-				  MotorThrottle(&sabertooth_handler, RIGHT_INDEX+1, motor_command[RIGHT_INDEX]);
-			  #endif
-
-			}
-
-			if (CX_CONTROL){
-				//Data received from ros is integer format, multiplied by 1000
-				linear_limit.v = (float)(setpoint_vel[LEFT_INDEX] + setpoint_vel[RIGHT_INDEX]) / 2;
-				angular_limit.v = (float)(setpoint_vel[LEFT_INDEX] - setpoint_vel[RIGHT_INDEX]) / BASE_WIDTH;
-				linear_limit.curr_t = angular_limit.curr_t = HAL_GetTick();
-				SL_Limit(&linear_limit);
-				SL_Limit(&angular_limit);
-				setpoint_vel[LEFT_INDEX] = linear_limit.v - angular_limit.v * BASE_WIDTH / 2;
-				setpoint_vel[RIGHT_INDEX] = linear_limit.v + angular_limit.v * BASE_WIDTH / 2;
-				double tmp1 = PID_getOutput(&left_pid,velocity[LEFT_INDEX], setpoint_vel[LEFT_INDEX]);
-				double tmp2 = PID_getOutput(&right_pid,velocity[RIGHT_INDEX], setpoint_vel[RIGHT_INDEX]);
-				motor_command[LEFT_INDEX] = (tmp1 / (v_i * 0.9735)) * 2047;
-				motor_command[RIGHT_INDEX] = (tmp2 / (v_i * 0.9735)) * 2047;
-			}
-			  }
-	 //If e stop engaged, override setpoints to 0
-	 				if (e_stop == 1) {
-	 					setpoint_vel[LEFT_INDEX] = 0;
-	 					setpoint_vel[RIGHT_INDEX] = 0;
-	 				}
-
-	 				//If data is old, set setpoint to 0
-	 				else if ((HAL_GetTick() - prev_uart_time) > FREQUENCY * 0.2) {
-	 //					setpoint_vel[LEFT_INDEX] = 0;
-	 //					setpoint_vel[RIGHT_INDEX] = 0;
-	 					HAL_UART_Receive_DMA(&ROS_UART, data_from_ros_raw,
-	 							SIZE_DATA_FROM_ROS);
-	 				}
-#ifndef SERIAL_CONTROL
-
-				MOTOR_TIM.Instance->RIGHT_MOTOR_CHANNEL =
-						motor_command[LEFT_INDEX] + 1500;
-				MOTOR_TIM.Instance->LEFT_MOTOR_CHANNEL =
-						motor_command[RIGHT_INDEX] + 1500;
-#else
-				  MotorThrottle(&sabertooth_handler, LEFT_INDEX+1, motor_command[LEFT_INDEX]);
-				  MotorThrottle(&sabertooth_handler, RIGHT_INDEX+1, motor_command[RIGHT_INDEX]);
-			  #endif
-
-
-//			if ((HAL_GetTick() - prev_st_uart_time) > FREQUENCY * 0.005) {
-//				  setpoint_vel[LEFT_INDEX] = 0;
-//				  setpoint_vel[RIGHT_INDEX] = 0;
-//				count = 2;
-//				MotorReadCurrent(&sabertooth_handler, LEFT_MOTOR);
-//			}
-
-
-			//calculate pwm
-//			float duty_cycle = v / (v_i * 0.9735);
-//			motor_command[LEFT_INDEX] = (int) (duty_cycle * 500.0);
-//			motor_command[RIGHT_INDEX] = (int) (duty_cycle * 500.0);
-//
-//			if (e_stop == 1) {
-//				motor_command[LEFT_INDEX] = 0;
-//				motor_command[RIGHT_INDEX] = 0;
-//				duty_cycle = 0;
-//			}
-
-			//Send PID commands to motor
-//#ifndef SERIAL_CONTROL
-//
-//			MOTOR_TIM.Instance->LEFT_MOTOR_CHANNEL = motor_command[RIGHT_INDEX]
-//					+ 1500;
-//			MOTOR_TIM.Instance->RIGHT_MOTOR_CHANNEL = motor_command[LEFT_INDEX]
-//					+ 1500;
-//#else
-//					  MotorThrottle(&sabertooth_handler, LEFT_INDEX+1, motor_command[LEFT_INDEX]);
-//					  MotorThrottle(&sabertooth_handler, RIGHT_INDEX+1, motor_command[RIGHT_INDEX]);
-//		  #endif
-#ifdef USB_ACTIVATE
-			//Send setpoint, controller effort, and feedback
-			send_formatter.current_1.b16 = setpoint_vel[LEFT_INDEX] * 1000;
-			send_formatter.current_2.b16 = setpoint_vel[RIGHT_INDEX] * 1000;
-			send_formatter.duty_cycle_1.b16 = motor_command[LEFT_INDEX];
-			send_formatter.duty_cycle_2.b16 = motor_command[RIGHT_INDEX];
-			send_formatter.velocity_1.b16 = unfiltered_vel[LEFT_INDEX] * 1000;
-			send_formatter.velocity_2.b16 = unfiltered_vel[RIGHT_INDEX]* 1000;
-			send_formatter.voltage.b16 = sabertooth_handler.motor1.battery;
-			DataLog_Manager(&send_formatter);
-#endif
-			prev_time = HAL_GetTick();
-		}
+		SCHED_Run(&scheduler);
 		/* USER CODE END WHILE */
 
 		/* USER CODE BEGIN 3 */
@@ -696,39 +582,8 @@ int main(void) {
  * @retval None
  */
 void SystemClock_Config(void) {
-	RCC_OscInitTypeDef RCC_OscInitStruct = { 0 };
-	RCC_ClkInitTypeDef RCC_ClkInitStruct = { 0 };
-
-	/** Configure the main internal regulator output voltage
-	 */
-	__HAL_RCC_PWR_CLK_ENABLE();
-	__HAL_PWR_VOLTAGESCALING_CONFIG(PWR_REGULATOR_VOLTAGE_SCALE3);
-	/** Initializes the RCC Oscillators according to the specified parameters
-	 * in the RCC_OscInitTypeDef structure.
-	 */
-	RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSE;
-	RCC_OscInitStruct.HSEState = RCC_HSE_ON;
-	RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
-	RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSE;
-	RCC_OscInitStruct.PLL.PLLM = 4;
-	RCC_OscInitStruct.PLL.PLLN = 72;
-	RCC_OscInitStruct.PLL.PLLP = RCC_PLLP_DIV2;
-	RCC_OscInitStruct.PLL.PLLQ = 3;
-	if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK) {
-		Error_Handler();
-	}
-	/** Initializes the CPU, AHB and APB buses clocks
-	 */
-	RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK
-			| RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
-	RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
-	RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
-	RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV2;
-	RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
-
-	if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_2) != HAL_OK) {
-		Error_Handler();
-	}
+	//PLL, regulator, flash wait states, bus prescalers and ART all come from the profile
+	CLK_Configure(CLOCK_PROFILE);
 }
 
 /**
@@ -753,10 +608,10 @@ static void MX_ADC1_Init(void) {
 	hadc1.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV8;
 	hadc1.Init.Resolution = ADC_RESOLUTION_12B;
 	hadc1.Init.ScanConvMode = ENABLE;
-	hadc1.Init.ContinuousConvMode = ENABLE;
+	hadc1.Init.ContinuousConvMode = DISABLE;
 	hadc1.Init.DiscontinuousConvMode = DISABLE;
-	hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
-	hadc1.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+	hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+	hadc1.Init.ExternalTrigConv = ADC_EXTERNALTRIGCONV_T2_TRGO;
 	hadc1.Init.DataAlign = ADC_DATAALIGN_RIGHT;
 	hadc1.Init.NbrOfConversion = 2;
 	hadc1.Init.DMAContinuousRequests = ENABLE;
@@ -780,7 +635,10 @@ static void MX_ADC1_Init(void) {
 		Error_Handler();
 	}
 	/* USER CODE BEGIN ADC1_Init 2 */
-	HAL_ADC_Start_DMA(&hadc1, &joystick_raw, 2);
+	//One scan of both channels per TIM2 update, DMA interrupts only at half and full buffer
+	JOY_Init(&joystick);
+	HAL_ADC_Start_DMA(&hadc1, (uint32_t*) joystick_dma, JOY_DMA_LENGTH);
+	HAL_TIM_Base_Start(&htim2);
 	/* USER CODE END ADC1_Init 2 */
 
 }
@@ -807,7 +665,7 @@ static void MX_SPI1_Init(void) {
 	hspi1.Init.CLKPolarity = SPI_POLARITY_LOW;
 	hspi1.Init.CLKPhase = SPI_PHASE_1EDGE;
 	hspi1.Init.NSS = SPI_NSS_SOFT;
-	hspi1.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_64;
+	hspi1.Init.BaudRatePrescaler = CLK_SpiPrescaler(SPI1, ENCODER1_SPI_HZ);
 	hspi1.Init.FirstBit = SPI_FIRSTBIT_MSB;
 	hspi1.Init.TIMode = SPI_TIMODE_DISABLE;
 	hspi1.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
@@ -843,7 +701,7 @@ static void MX_SPI4_Init(void) {
 	hspi4.Init.CLKPolarity = SPI_POLARITY_HIGH;
 	hspi4.Init.CLKPhase = SPI_PHASE_2EDGE;
 	hspi4.Init.NSS = SPI_NSS_SOFT;
-	hspi4.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_128;
+	hspi4.Init.BaudRatePrescaler = CLK_SpiPrescaler(SPI4, IMU_SPI_HZ);
 	hspi4.Init.FirstBit = SPI_FIRSTBIT_MSB;
 	hspi4.Init.TIMode = SPI_TIMODE_DISABLE;
 	hspi4.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
@@ -879,7 +737,7 @@ static void MX_SPI6_Init(void) {
 	hspi6.Init.CLKPolarity = SPI_POLARITY_LOW;
 	hspi6.Init.CLKPhase = SPI_PHASE_1EDGE;
 	hspi6.Init.NSS = SPI_NSS_SOFT;
-	hspi6.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_32;
+	hspi6.Init.BaudRatePrescaler = CLK_SpiPrescaler(SPI6, ENCODER2_SPI_HZ);
 	hspi6.Init.FirstBit = SPI_FIRSTBIT_MSB;
 	hspi6.Init.TIMode = SPI_TIMODE_DISABLE;
 	hspi6.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
@@ -893,6 +751,48 @@ static void MX_SPI6_Init(void) {
 
 }
 
+/**
+ * @brief TIM2 Initialization Function
+ * @param None
+ * @retval None
+ */
+static void MX_TIM2_Init(void) {
+
+	/* USER CODE BEGIN TIM2_Init 0 */
+
+	/* USER CODE END TIM2_Init 0 */
+
+	TIM_ClockConfigTypeDef sClockSourceConfig = { 0 };
+	TIM_MasterConfigTypeDef sMasterConfig = { 0 };
+
+	/* USER CODE BEGIN TIM2_Init 1 */
+	//Only used as the joystick ADC trigger, 1MHz count, update at JOY_SAMPLE_HZ
+	/* USER CODE END TIM2_Init 1 */
+	htim2.Instance = TIM2;
+	htim2.Init.Prescaler = CLK_TimerPrescaler(TIM2, 1000000);
+	htim2.Init.CounterMode = TIM_COUNTERMODE_UP;
+	htim2.Init.Period = 1000000 / JOY_SAMPLE_HZ - 1;
+	htim2.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+	htim2.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+	if (HAL_TIM_Base_Init(&htim2) != HAL_OK) {
+		Error_Handler();
+	}
+	sClockSourceConfig.ClockSource = TIM_CLOCKSOURCE_INTERNAL;
+	if (HAL_TIM_ConfigClockSource(&htim2, &sClockSourceConfig) != HAL_OK) {
+		Error_Handler();
+	}
+	sMasterConfig.MasterOutputTrigger = TIM_TRGO_UPDATE;
+	sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+	if (HAL_TIMEx_MasterConfigSynchronization(&htim2, &sMasterConfig)
+			!= HAL_OK) {
+		Error_Handler();
+	}
+	/* USER CODE BEGIN TIM2_Init 2 */
+
+	/* USER CODE END TIM2_Init 2 */
+
+}
+
 /**
  * @brief TIM4 Initialization Function
  * @param None
@@ -909,10 +809,10 @@ static void MX_TIM4_Init(void) {
 	TIM_OC_InitTypeDef sConfigOC = { 0 };
 
 	/* USER CODE BEGIN TIM4_Init 1 */
-
+	//1us count on every clock profile, compare values are the RC pulse width in us
 	/* USER CODE END TIM4_Init 1 */
 	htim4.Instance = TIM4;
-	htim4.Init.Prescaler = 72 - 1;
+	htim4.Init.Prescaler = CLK_TimerPrescaler(TIM4, 1000000);
 	htim4.Init.CounterMode = TIM_COUNTERMODE_UP;
 	htim4.Init.Period = 20000 - 1;
 	htim4.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
@@ -1128,154 +1028,505 @@ static void MX_CRC_Init(void) {
 
 }
 /* USER CODE BEGIN 4 */
-void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc) {
-	//If adc callback by joystick adc
-	if (hadc == &hadc1) {
-		//Both channels of ADC (channel 0 and channel 1) are each 16 bit
-		//Both are stored in joystick_raw, a 32bit unsigned int
-		//Separate both readings in the below code into 2 variables
-		joystick[1] = joystick[1] * (1 - joystick_filter)
-				+ (joystick_raw & 0x0000FFFF) * joystick_filter;
-		joystick[0] = joystick[0] * (1 - joystick_filter)
-				+ (joystick_raw >> 16) * joystick_filter;
+/**
+ * \brief IMU acquisition. Polls the IMU at its own output rate, filters each new sample and updates the
+ * calibration and attitude estimate. Outputs: gyro/acc (raw counts for telemetry), imu_calib, attitude
+ */
+static void imuTask(void) {
+	//Filter state is kept in float, the raw count telemetry is only rounded on the way out
+	if (imuRead()) {
+		uint32_t now = TB_Micros();
+		for (int i = 0; i < 3; ++i) {
+			gyro[i] = (int16_t) lrintf(BQ_Step(&imu_filter[i], imu_gyro_raw[i]));
+			acc[i] = (int16_t) lrintf(BQ_Step(&imu_filter[3 + i], imu_acc_raw[i]));
+		}
+		imuConvert(imu_acc_raw, imu_gyro_raw, acc_si, gyro_si);
+		CALIB_Apply(&imu_calib, acc_si, gyro_si, (now - imu_stamp) * 1e-6f);
+		ATT_Update(&attitude, imu_calib.gyro, imu_calib.acc, now);
+		imu_stamp = now;
 	}
 }
 
-// UART data reception callback function
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
-	static int huart_synchronized = 0;
-
-	static uint8_t synchronize_data;
-	if (huart == &ROS_UART) {
-		//Serial connection to ROS might have been made midway through a full packet
-		//Therefore, read the packets 1 by 1 until the end byte is reached.
-		//Once reached, then uart from ros to stm32 is synchronized, read all bytes as normal after that
-		if (huart_synchronized < 2) {
-			//LSB First, check byte is 0xFFFB
-			if (huart_synchronized == 0) {
-				if (synchronize_data == 0xFB)
-					huart_synchronized++;
-			}
+/**
+ * \brief Wheel and switch acquisition, once per control tick. Outputs: velocity, odometry, e_stop
+ */
+static void sensorTask(void) {
+	encoderRead(encoder);
+	calcVelFromEncoder(encoder, velocity);
+	velocity[LEFT_INDEX] = BQ_Step(&velocity_filter[LEFT_INDEX], velocity[LEFT_INDEX]);
+	velocity[RIGHT_INDEX] = BQ_Step(&velocity_filter[RIGHT_INDEX], velocity[RIGHT_INDEX]);
+	CALIB_UpdateStandstill(&imu_calib, velocity, HAL_GetTick());
+	ODOM_Update(&odometry, encoder, imu_calib.gyro[2]);
+	uint16_t prev_e_stop = e_stop;
+	e_stop = HAL_GPIO_ReadPin(GPIOB, GPIO_PIN_12);
+	if (e_stop != prev_e_stop)
+		TRACE_Event(TRACE_EV_ESTOP, e_stop, 0);
+}
 
-			else {
-				if (synchronize_data == 0xFF)
-					huart_synchronized++;
-			}
+/**
+ * \brief Host commands. Parses ROS frames into cmd_buffer and clock_sync.
+ * Runs before the control task so a command is used in the tick it arrived
+ */
+static void hostCommandTask(void) {
+	//ROS frames are parsed from the DMA ring, commands go to the command buffer and pings to clock sync
+	LINK_Poll(&ros_link, TB_Micros64(), HAL_GetTick());
+}
 
-			//Check if uart is still not synchronized. If not, then continue receiving single bytes
-			if (huart_synchronized < 2) {
-				HAL_UART_Receive_DMA(&ROS_UART, &synchronize_data, 1);
-				return;
-			}
+/**
+ * \brief Command shaping, every control tick so the wheel setpoints follow the interpolated commands
+ * and the jerk limited profile without steps. Inputs: cmd_buffer, joystick, e_stop.
+ * Outputs: cmd_linear, cmd_angular
+ */
+static void limiterTask(void) {
+	//Pick the command source (joystick, fresh ROS frame or none) and shape it through the shared speed profile.
+	//This runs every period, so the limiter state carries across a handover and a stale ROS command
+	//ramps down to zero instead of being held. ROS commands are interpolated from the command buffer,
+	//a scheduled run keeps ROS in control while it has points left to play
+	float ros_left = 0, ros_right = 0;
+	uint8_t ros_valid = CMD_Sample(&cmd_buffer, TB_Micros(), &ros_left, &ros_right);
+	uint32_t ros_tick = cmd_buffer.state == CMD_INTERPOLATING ? HAL_GetTick() : ros_link.last_frame;
+	DRIVE_Update(&drive, &joystick, ros_left, ros_right,
+			ros_valid ? ros_tick : 0, e_stop == 1, HAL_GetTick());
+	//The request is scaled into the axis and wheel speed limits so its curvature survives, then both
+	//axes are shaped by one jerk limited profile that respects the axis and wheel acceleration limits
+	cmd_linear = drive.linear;
+	cmd_angular = drive.angular;
+	KL_LimitRequest(&kinematic_limit, &cmd_linear, &cmd_angular);
+	KL_Limit(&kinematic_limit, &cmd_linear, &cmd_angular, HAL_GetTick());
+}
 
-			//Else start receiving all the bytes from ROS like normal
-			else {
-				HAL_UART_Receive_DMA(&ROS_UART, data_from_ros_raw,
-						SIZE_DATA_FROM_ROS);
-				return;
-			}
+/**
+ * \brief Hard real time control, once per control tick. Inputs: sensor task outputs, cmd_linear and
+ * cmd_angular. Outputs: setpoint_vel, motor_command, brake and motor PWM
+ */
+static void controlTask(void) {
+	//For data logging
+	angular_velocity[LEFT_INDEX] = velocity[LEFT_INDEX];
+	angular_velocity[RIGHT_INDEX] = velocity[RIGHT_INDEX];
+
+	setpoint_vel[LEFT_INDEX] = cmd_linear - cmd_angular * BASE_WIDTH / 2;
+	setpoint_vel[RIGHT_INDEX] = cmd_linear + cmd_angular * BASE_WIDTH / 2;
+
+	if (BY_CONTROL) {
+		//Outer yaw rate loop on the calibrated gyro. Its output is added as a differential wheel
+		//speed on top of the commanded one, the wheel PIDs below stay as the inner loop
+		double yaw_rate = ODOM_GYRO_Z_SIGN * imu_calib.gyro[2];
+		if (setpoint_vel[LEFT_INDEX] == 0 && setpoint_vel[RIGHT_INDEX] == 0) {
+			PID_reset(&yaw_pid);
+		} else {
+			double yaw_correction = PID_getOutput(&yaw_pid, yaw_rate, cmd_angular);
+			setpoint_vel[LEFT_INDEX] -= yaw_correction * BASE_WIDTH / 2;
+			setpoint_vel[RIGHT_INDEX] += yaw_correction * BASE_WIDTH / 2;
 		}
 
-		//Receive buffer is already synchronized
-		else {
-			//Mark previous UART time
-			prev_uart_time = HAL_GetTick();
-
-			//Combine check bit to ensure uart is still synchronized, otherwise reset synchronized flag
-			data_from_ros[SIZE_DATA_FROM_ROS / 2 - 1] =
-					(int16_t) data_from_ros_raw[SIZE_DATA_FROM_ROS - 1] << 8
-							| data_from_ros_raw[SIZE_DATA_FROM_ROS - 2];
-			if ((uint16_t) data_from_ros[SIZE_DATA_FROM_ROS / 2 - 1]
-					== 0xFFFB) {
-				//Combine 8bit data to 16bit, for use in main while loop
-				for (int i = 0; i < SIZE_DATA_FROM_ROS; i += 2)
-					data_from_ros[i / 2] = (int16_t) data_from_ros_raw[i + 1]
-							<< 8 | (int16_t) data_from_ros_raw[i];
-
-				//Receive next data from ROS
-				HAL_UART_Receive_DMA(&ROS_UART, data_from_ros_raw,
-						SIZE_DATA_FROM_ROS);
-				return;
-			}
+		//Motor feedforward, speed dependent gain per wheel and direction
+		PID_setF(&left_pid, FF_Gain(LEFT_INDEX, setpoint_vel[LEFT_INDEX]) * SCALING);
+		PID_setF(&right_pid, FF_Gain(RIGHT_INDEX, setpoint_vel[RIGHT_INDEX]) * SCALING);
 
-			//Data is no longer synchronized, reset
-			else {
-				huart_synchronized = 0;
-				HAL_UART_Receive_DMA(&ROS_UART, &synchronize_data, 1);
-				return;
-			}
+		//If e stop engaged, override setpoints to 0
+		if (e_stop == 1) {
+			setpoint_vel[LEFT_INDEX] = 0;
+			setpoint_vel[RIGHT_INDEX] = 0;
+		}
+//					else if ((HAL_GetTick() - prev_st_uart_time)
+//						> FREQUENCY * 0.005) {
+////					MotorReadBattery(&sabertooth_handler);
+//				}
+
+		//Unbrake motors if there is command, brake otherwise. The supervisor holds them on a fault
+		if (!SUP_Faulted(&supervisor))
+			setBrakes();
+
+		//Ensure there is a commanded velocity, otherwise reset PID
+		if (fabs(setpoint_vel[LEFT_INDEX]) == 0
+				&& fabs(velocity[LEFT_INDEX]) < 0.05) {
+			motor_command[LEFT_INDEX] = 0;
+			PID_reset(&left_pid);
+		}
+
+		else if (!braked) {
+			//Ramp limits and gains for the current speed and direction
+			GS_Apply(&left_schedule, &left_pid, setpoint_vel[LEFT_INDEX],
+					velocity[LEFT_INDEX]);
+
+			motor_command[LEFT_INDEX] = PID_getOutput(&left_pid,
+					velocity[LEFT_INDEX], setpoint_vel[LEFT_INDEX]);
+		}
+
+		//Ensure there is a commanded velocity, otherwise reset PID
+		if (fabs(setpoint_vel[RIGHT_INDEX]) == 0
+				&& fabs(velocity[RIGHT_INDEX]) < 0.05) {
+			motor_command[RIGHT_INDEX] = 0;
+			PID_reset(&right_pid);
+		}
+
+		else if (!braked) {
+			//Ramp limits and gains for the current speed and direction
+			GS_Apply(&right_schedule, &right_pid, setpoint_vel[RIGHT_INDEX],
+					velocity[RIGHT_INDEX]);
 
+			motor_command[RIGHT_INDEX] = PID_getOutput(&right_pid,
+					velocity[RIGHT_INDEX], setpoint_vel[RIGHT_INDEX]);
 		}
 	}
 
+	if (CX_CONTROL){
+		//PID output is the motor voltage, both wheels step together at the PID rate
+		uint32_t pid_elapsed = HAL_GetTick() - wheel_pid_time;
+		if (pid_elapsed >= FREQUENCY / pid_freq) {
+			float wheel_sp[2] = { setpoint_vel[LEFT_INDEX], setpoint_vel[RIGHT_INDEX] };
+			float wheel_vel[2] = { velocity[LEFT_INDEX], velocity[RIGHT_INDEX] };
+			float volts[2];
+			wheel_pids.f[LEFT_INDEX] = FF_Gain(LEFT_INDEX, wheel_sp[LEFT_INDEX]);
+			wheel_pids.f[RIGHT_INDEX] = FF_Gain(RIGHT_INDEX, wheel_sp[RIGHT_INDEX]);
+			PIDB_Step(&wheel_pids, wheel_vel, wheel_sp,
+					(float) pid_elapsed / FREQUENCY, volts);
+			wheel_pid_time += pid_elapsed;
+			motor_command[LEFT_INDEX] = FF_VoltsToCommand(volts[LEFT_INDEX]);
+			motor_command[RIGHT_INDEX] = FF_VoltsToCommand(volts[RIGHT_INDEX]);
+		}
+	}
+	//If e stop engaged, override setpoints to 0
+	if (e_stop == 1) {
+		setpoint_vel[LEFT_INDEX] = 0;
+		setpoint_vel[RIGHT_INDEX] = 0;
+	}
+
+#ifdef SYSID_MODE
+	//Identification overrides the controllers. Both wheels get the same voltage and the
+	//response is the mean wheel velocity. Runs once per boot, e stop or a supervisor fault aborts it
+	if (e_stop == 1 || SUP_Faulted(&supervisor)) {
+		SYSID_Stop(&sysid);
+	} else if (!sysid_started) {
+		SYSID_Start(&sysid, &sysid_config);
+		sysid_started = 1;
+	}
+	sysid_volts = SYSID_Step(&sysid,
+			sysid_applied,
+			(velocity[LEFT_INDEX] + velocity[RIGHT_INDEX]) / 2);
+	if (!sysid.active)
+		sysid_volts = 0;
+	motor_command[LEFT_INDEX] = FF_VoltsToCommand(sysid_volts);
+	motor_command[RIGHT_INDEX] = FF_VoltsToCommand(sysid_volts);
+	SYSID_Flush(&sysid);
+#endif
+
+#ifdef AUTOTUNE_MODE
+	//Both wheels run their own relay at once, e stop aborts the run
+	if (!autotune_started && e_stop == 0) {
+		for (int w = 0; w < 2; ++w) {
+			autotune_config.bias = FF_Gain(w, autotune_config.setpoint)
+					* autotune_config.setpoint * (BY_CONTROL ? SCALING : 1);
+			AT_Start(&autotune[w], &autotune_config, HAL_GetTick());
+		}
+		autotune_started = 1;
+	}
+	for (int w = 0; w < 2; ++w) {
+		if (e_stop == 1)
+			autotune[w].state = AT_FAILED;
+		float u = autotune[w].state == AT_RUNNING ?
+				AT_Step(&autotune[w], velocity[w], HAL_GetTick()) : 0;
+		motor_command[w] = CX_CONTROL ? FF_VoltsToCommand(u) : u;
+	}
+	//Store once both are over and the wheels have stopped, the flash write stalls the loop
+	if (autotune_started && !autotune_finished
+			&& autotune[LEFT_INDEX].state != AT_RUNNING
+			&& autotune[RIGHT_INDEX].state != AT_RUNNING
+			&& fabs(velocity[LEFT_INDEX]) < 0.05
+			&& fabs(velocity[RIGHT_INDEX]) < 0.05) {
+		for (int w = 0; w < 2; ++w) {
+			if (autotune[w].state == AT_DONE)
+				AT_Compute(&autotune[w], AUTOTUNE_RULE);
+		}
+		SUP_Stall(&supervisor, SUP_FLASH_STALL_MS);
+		AT_Save(autotune, BY_CONTROL ? FF_BY : FF_CX);
+		autotune_finished = 1;
+	}
+	//One report per tick, the CDC endpoint refuses a transfer while the previous one is in flight
+	if (autotune_finished && autotune_reported < 2
+			&& AT_Report(&autotune[autotune_reported], autotune_reported) == USBD_OK)
+		autotune_reported++;
+#endif
+	//A supervisor fault holds the motors at zero with the brake on until the loop has recovered. The
+	//motor outputs below are the only write of the tick, so a faulted tick never sends the PID command
+	if (SUP_Faulted(&supervisor)) {
+		motor_command[LEFT_INDEX] = 0;
+		motor_command[RIGHT_INDEX] = 0;
+		BRAKE_TIM.Instance->BRAKE_CHANNEL = 1000;
+		braked = 1;
+		PID_reset(&left_pid);
+		PID_reset(&right_pid);
+		PIDB_Reset(&wheel_pids, LEFT_INDEX);
+		PIDB_Reset(&wheel_pids, RIGHT_INDEX);
+	}
+#ifndef SERIAL_CONTROL
+	MOTOR_TIM.Instance->RIGHT_MOTOR_CHANNEL =
+			motor_command[LEFT_INDEX] + 1500;
+	MOTOR_TIM.Instance->LEFT_MOTOR_CHANNEL =
+			motor_command[RIGHT_INDEX] + 1500;
+#else
+	MotorThrottle(&sabertooth_handler, LEFT_INDEX+1, motor_command[LEFT_INDEX]);
+	MotorThrottle(&sabertooth_handler, RIGHT_INDEX+1, motor_command[RIGHT_INDEX]);
+#endif
+#ifdef SYSID_MODE
+	//Identification integrates what was sent, not what it asked for
+	sysid_applied = FF_CommandToVolts(motor_command[LEFT_INDEX]);
+#endif
+
+//			if ((HAL_GetTick() - prev_st_uart_time) > FREQUENCY * 0.005) {
+//				  setpoint_vel[LEFT_INDEX] = 0;
+//				  setpoint_vel[RIGHT_INDEX] = 0;
+//				count = 2;
+//				MotorReadCurrent(&sabertooth_handler, LEFT_MOTOR);
+//			}
+}
+
+/**
+ * \brief Control tick at FREQUENCY: wheel sensors, host commands, command shaping and control in data
+ * flow order, timed by the supervisor
+ */
+static void controlTickTask(void) {
+	SUP_TickBegin(&supervisor, TB_Micros(), HAL_GetTick());
+#ifdef LOOP_BENCHMARK
+	uint32_t loop_start = DWT->CYCCNT;
+#endif
+	sensorTask();
+	hostCommandTask();
+	limiterTask();
+	controlTask();
+
+#ifdef LOOP_BENCHMARK
+	if (!supervisor.stall_ms) {
+		uint32_t cycles = DWT->CYCCNT - loop_start;
+		uint32_t bin = cycles / (SystemCoreClock / 1000000) / LOOP_HIST_BIN_US;
+		loop_hist[MIN(bin, LOOP_HIST_BINS - 1)]++;
+		loop_cycles_worst = MAX(loop_cycles_worst, cycles);
+		loop_cycles_total += cycles;
+		loop_ticks++;
+	}
+#endif
+	SUP_TickEnd(&supervisor, TB_Micros(),
+			setpoint_vel[LEFT_INDEX] == 0 && setpoint_vel[RIGHT_INDEX] == 0);
+}
+
+/**
+ * \brief USB requests, logging and persistence at FREQUENCY. Checks the packet the USB interrupt took,
+ * sends USB trace dumps and the data log, and stores the IMU calibration
+ */
+static void logTask(void) {
+	//The CRC unit is shared with the flash parameter store, packets are checked here and not in the interrupt
+	USB_Receive_Cargo();
+	//Trace dumps are requested over USB and take the endpoint from the data log until done
+	if (hUSB.ifNewCargo) {
+		hUSB.ifNewCargo = 0;
+		if (hUSB.rxMessageLen >= 2 && hUSB.rxMessageCfrm[0] == TRACE_TAG_REQUEST)
+			TRACE_StartDump(&trace_dump, hUSB.rxMessageCfrm[1]);
+		else if (hUSB.rxMessageLen >= 2 && hUSB.rxMessageCfrm[0] == CALIB_TAG_REQUEST)
+			CALIB_Request(&imu_calib, hUSB.rxMessageCfrm[1]);
+	}
+	TRACE_Flush(&trace_dump);
+	CALIB_Flush(&imu_calib);
+
+#ifdef USB_ACTIVATE
+	//Send setpoint, controller effort, and feedback
+	send_formatter.current_1.b16 = setpoint_vel[LEFT_INDEX] * 1000;
+	send_formatter.current_2.b16 = setpoint_vel[RIGHT_INDEX] * 1000;
+	send_formatter.duty_cycle_1.b16 = motor_command[LEFT_INDEX];
+	send_formatter.duty_cycle_2.b16 = motor_command[RIGHT_INDEX];
+	send_formatter.velocity_1.b16 = unfiltered_vel[LEFT_INDEX] * 1000;
+	send_formatter.velocity_2.b16 = unfiltered_vel[RIGHT_INDEX]* 1000;
+	send_formatter.voltage.b16 = sabertooth_handler.motor1.battery;
+	if (trace_dump.ring == NULL)
+		DataLog_Manager(&send_formatter);
+#endif
+	//Flash write stalls the loop, only do it with the chair parked. Automatic saves happen once per boot
+	if (braked && imu_calib.stationary && setpoint_vel[LEFT_INDEX] == 0
+			&& setpoint_vel[RIGHT_INDEX] == 0 && CALIB_SaveDue(&imu_calib)) {
+		SUP_Stall(&supervisor, SUP_FLASH_STALL_MS);
+		CALIB_Save(&imu_calib);
+	}
+}
+
+/**
+ * \brief ROS telemetry at TELEMETRY_HZ. Fills and sends the next frame once the last one is out
+ */
+static void telemetryTask(void) {
+	if (ROS_UART.gState != HAL_UART_STATE_READY)
+		return;
+
+	//Joystick values are averaged and filtered ADC counts, channel 0 then channel 1
+	data_to_ros[0] = (uint16_t) lrintf(joystick.raw[0]);
+	data_to_ros[1] = (uint16_t) lrintf(joystick.raw[1]);
+
+	//Convert velocity to integer for transferring. ROS node will divide the result by 1000
+	data_to_ros[2] = (int16_t) (velocity[LEFT_INDEX] * 1000);
+	data_to_ros[3] = (int16_t) (velocity[RIGHT_INDEX] * 1000);
+
+	//Acceleration and gyro is in raw format from IMU, int16_t
+	data_to_ros[4] = acc[0];
+	data_to_ros[5] = acc[1];
+	data_to_ros[6] = acc[2];
+
+	data_to_ros[7] = gyro[0];
+	data_to_ros[8] = gyro[1];
+	data_to_ros[9] = gyro[2];
+
+	data_to_ros[10] = e_stop;
+
+	//Encoder fault counters, lower 16 bits. ROS node handles the wrap around
+	data_to_ros[11] = (uint16_t) encoder_status[LEFT_INDEX].error_count;
+	data_to_ros[12] = (uint16_t) encoder_status[RIGHT_INDEX].error_count;
+	data_to_ros[13] = (uint16_t) encoder_status[LEFT_INDEX].timeout_count;
+	data_to_ros[14] = (uint16_t) encoder_status[RIGHT_INDEX].timeout_count;
+
+	//Current run of rejected frames, left in the low byte and right in the high byte
+	data_to_ros[15] = MIN(encoder_status[LEFT_INDEX].consecutive_faults, 0xFF)
+			| MIN(encoder_status[RIGHT_INDEX].consecutive_faults, 0xFF) << 8;
+
+	//Dead reckoning pose integrated at the control rate. Position in mm, heading in 1e-4 rad,
+	//stamp is the HAL tick of the odometry update. 32 bit values are sent low word first
+	odomPose pose = odometry.published;
+	packInt32(&data_to_ros[16], (int32_t) (pose.x * 1000));
+	packInt32(&data_to_ros[18], (int32_t) (pose.y * 1000));
+	data_to_ros[20] = (int16_t) (pose.theta * 10000);
+	packInt32(&data_to_ros[21], (int32_t) pose.stamp);
+
+	//Lower 32 bits of the wheel tick counters
+	packInt32(&data_to_ros[23], (int32_t) pose.ticks[LEFT_INDEX]);
+	packInt32(&data_to_ros[25], (int32_t) pose.ticks[RIGHT_INDEX]);
+
+	//Attitude from the on-board filter. Roll and pitch in 1e-4 rad, yaw rate in 1e-3 rad/s,
+	//stamp is the microsecond timebase at the last IMU sample
+	data_to_ros[27] = (int16_t) (attitude.roll * 10000);
+	data_to_ros[28] = (int16_t) (attitude.pitch * 10000);
+	data_to_ros[29] = (int16_t) (attitude.yaw_rate * 1000);
+	packInt32(&data_to_ros[30], (int32_t) attitude.stamp);
+
+	//Calibrated IMU in the chair frame, acceleration in 1e-3 m/s2 and rate in 1e-3 rad/s
+	for (int i = 0; i < 3; ++i) {
+		data_to_ros[32 + i] = (int16_t) (imu_calib.acc[i] * 1000);
+		data_to_ros[35 + i] = (int16_t) (imu_calib.gyro[i] * 1000);
+	}
+
+	//Calibration status: bit 0 standing still, bit 1 stored calibration in use, bit 2 saved this boot,
+	//high byte is the implausible accel counter
+	data_to_ros[38] = imu_calib.stationary | imu_calib.loaded << 1 | imu_calib.saved << 2
+			| MIN(imu_calib.acc_faults, 0xFF) << 8;
+
+	//Calibrated joystick deflection in 1e-4, channel 0 then channel 1
+	data_to_ros[39] = (int16_t) (joystick.axis[0] * 10000);
+	data_to_ros[40] = (int16_t) (joystick.axis[1] * 10000);
+
+	//Active command source, see driveSource
+	data_to_ros[41] = drive.source;
+
+	//Playback delay of the ROS command buffer in 1e-4 s
+	data_to_ros[42] = (uint16_t) (cmd_buffer.delay / 100);
+
+	//Clock sync. The frame stamp is the time the last byte of this frame leaves the line and doubles
+	//as the pong for the last ping, whose sequence number and arrival time are echoed. The offset (host
+	//minus MCU time, low 32 bits, us) and drift (1e-8) are the MCU side estimate, the host can keep its
+	//own from the echoes. The drift saturates at +-327 ppm, the estimate can pass it while it settles
+	uint32_t frame_stamp = TB_Micros() + SIZE_DATA_TO_ROS * 2 * ros_link.char_time;
+	SYNC_Pong(&clock_sync, frame_stamp);
+	packInt32(&data_to_ros[43], (int32_t) frame_stamp);
+	data_to_ros[45] = (uint16_t) clock_sync.pong_seq;
+	packInt32(&data_to_ros[46], (int32_t) clock_sync.t2);
+	packInt32(&data_to_ros[48], (int32_t) clock_sync.offset);
+	data_to_ros[50] = (int16_t) fminf(fmaxf(clock_sync.drift * 1e8f, -32767), 32767);
+
+	//Loop supervisor: ticks over budget and skipped ticks (lower 16 bits), longest tick since the last
+	//frame in us, then the active fault in the low byte and the cause of the last reset in the high byte
+	data_to_ros[51] = (uint16_t) supervisor.overruns;
+	data_to_ros[52] = (uint16_t) supervisor.missed;
+	data_to_ros[53] = (uint16_t) MIN(supervisor.worst_us, 0xFFFF);
+	supervisor.worst_us = 0;
+	data_to_ros[54] = supervisor.fault | supervisor.last_reset << 8;
+
+	//Clock profile in the low byte and core clock in MHz in the high byte, then the share of the time
+	//since the last frame that no scheduled job ran, in 0.1%. Counts every task, not only the control tick
+	data_to_ros[55] = clk_profile | (SystemCoreClock / 1000000) << 8;
+	static uint64_t last_busy_us;
+	static uint32_t last_frame_us;
+	static uint8_t frame_sent;
+	uint32_t now_us = TB_Micros();
+	if (!frame_sent)
+		last_frame_us = scheduler.start;
+	uint32_t elapsed_us = now_us - last_frame_us;
+	uint64_t busy_us = scheduler.busy_us - last_busy_us;
+	data_to_ros[56] = elapsed_us == 0 ? 0 : 1000 - MIN(busy_us * 1000 / elapsed_us, 1000);
+	last_busy_us = scheduler.busy_us;
+	last_frame_us = now_us;
+	frame_sent = 1;
+
+	data_to_ros[SIZE_DATA_TO_ROS - 1] = (uint16_t) 0xabcd;
+
+	//Force STM32 to treat data_to_ros as a uint8_t pointer array as that is what's required.
+	//Data will get sent along as normal, then ROS end can combine 2 bytes of data to get original data
+	HAL_UART_Transmit_DMA(&ROS_UART, (uint8_t*) data_to_ros,
+			(uint16_t) SIZE_DATA_TO_ROS * 2);
+}
+
+#ifdef SERIAL_CONTROL
+/**
+ * \brief Sabertooth status polling at SABERTOOTH_POLL_HZ. One read request per release in rotation,
+ * the reply is handled in HAL_UART_RxCpltCallback
+ */
+static void sabertoothTask(void) {
+	static uint8_t read = 0;
+
+	read = read < 2 ? read + 1 : 0;
+	switch (read) {
+	case 0:
+		MotorReadBattery(&sabertooth_handler);
+		break;
+	case 1:
+		MotorReadCurrent(&sabertooth_handler, LEFT_MOTOR);
+		break;
+	case 2:
+		MotorReadCurrent(&sabertooth_handler, RIGHT_MOTOR);
+		break;
+	}
+}
+#endif
+
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc) {
+	//First half of the joystick buffer is complete, DMA is now filling the second half
+	if (hadc == &hadc1)
+		JOY_ProcessBlock(&joystick, &joystick_dma[0], HAL_GetTick());
+}
+
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc) {
+	//Second half is complete, DMA has wrapped to the first half
+	if (hadc == &hadc1)
+		JOY_ProcessBlock(&joystick, &joystick_dma[JOY_DMA_LENGTH / 2], HAL_GetTick());
+}
+
+// UART data reception callback function
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
+	//ROS commands are received circularly and parsed from the main loop, see ros_link.h
 	if (huart == &SABERTOOTH_UART) {
 		//Mark previous UART time
 		prev_st_uart_time = HAL_GetTick();
 		MotorProcessReply(&sabertooth_handler, motor_receive_buf,
 				sizeof(motor_receive_buf));
-		if (count < 3)
-			count++;
-		else
-			count = 2;
-//		HAL_UART_Receive_DMA(&SABERTOOTH_UART, motor_receive_buf, sizeof(motor_receive_buf));
-		//For data logging
-		switch (count) {
-		case 1:
-			MotorReadBattery(&sabertooth_handler);
-			break;
-		case 2:
-			MotorReadCurrent(&sabertooth_handler, LEFT_MOTOR);
-			break;
-		case 3:
-			MotorReadCurrent(&sabertooth_handler, RIGHT_MOTOR);
-			break;
-//		case 4:
-//			MotorReadDutyCycle(&sabertooth_handler, LEFT_MOTOR);
-//			break;
-//		case 5:
-//			MotorReadDutyCycle(&sabertooth_handler, RIGHT_MOTOR);
-//			break;
-		}
-
+		//The next read is requested by sabertoothTask
 	}
 }
 
 void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
-	//Callback triggeredby TX complete to ROS
-	if (huart == &ROS_UART) {
-		//Joystick values are raw ADC values, integer format
-		data_to_ros[0] = joystick[1];
-		data_to_ros[1] = joystick[0];
-
-		//Convert velocity to integer for transferring. ROS node will divide the result by 1000
-		data_to_ros[2] = (int16_t) (velocity[LEFT_INDEX] * 1000);
-		data_to_ros[3] = (int16_t) (velocity[RIGHT_INDEX] * 1000);
-
-		//Acceleration and gyro is in raw format from IMU, int16_t
-		data_to_ros[4] = acc[0];
-		data_to_ros[5] = acc[1];
-		data_to_ros[6] = acc[2];
-
-		data_to_ros[7] = gyro[0];
-		data_to_ros[8] = gyro[1];
-		data_to_ros[9] = gyro[2];
-
-		data_to_ros[10] = e_stop;
-
-		data_to_ros[11] = (uint16_t) 0xabcd;
-
-		//Send data to ros again
-		//Force STM32 to treat data_to_ros as a uint8_t pointer array as that is what's required.
-		//Data will get sent along as normal, then ROS end can combine 2 bytes of data to get original data
-		HAL_UART_Transmit_DMA(&ROS_UART, (uint8_t*) data_to_ros,
-				(uint16_t) SIZE_DATA_TO_ROS * 2);
-	}
+	//ROS frames are sent from telemetryTask
 	if (huart == &SABERTOOTH_UART) {
 		HAL_UART_Receive_DMA(&SABERTOOTH_UART, motor_receive_buf,
 				sizeof(motor_receive_buf));
 	}
 }
 
+void packInt32(uint16_t *dst, int32_t value) {
+	dst[0] = (uint16_t) (value & 0xFFFF);
+	dst[1] = (uint16_t) ((uint32_t) value >> 16);
+}
+
 void setBrakes() {
 	if ((setpoint_vel[LEFT_INDEX] != 0 || setpoint_vel[RIGHT_INDEX] != 0)) {
 		BRAKE_TIM.Instance->BRAKE_CHANNEL = 2000;
@@ -1310,6 +1561,9 @@ void setBrakes() {
 void Error_Handler(void) {
 	/* USER CODE BEGIN Error_Handler_Debug */
 	/* User can add his own implementation to report the HAL error return state */
+	TRACE_Event(TRACE_EV_ERROR, (uint32_t) (uintptr_t) __builtin_return_address(0), 0);
+	//Stop the chair and leave the rest to the watchdog
+	SUP_Panic(SUP_CAUSE_ERROR);
 	__disable_irq();
 	while (1) {
 
@@ -0,0 +1,128 @@
+/*
+ * attitude.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "attitude.h"
+#include "imu.h"
+#include "mem_sections.h"
+#include <math.h>
+#include <string.h>
+
+CCMRAM_BSS attitude_t attitude;
+
+//Level the quaternion from the gravity vector, yaw is left at zero
+static void levelFromAccel(attitude_t* att, const float* acc);
+
+static void updateEuler(attitude_t* att, const float* gyro);
+
+void ATT_Init(attitude_t* att, float kp, float ki)
+{
+	memset(att, 0, sizeof(*att));
+	att->q0 = 1.0f;
+	att->kp = kp;
+	att->ki = ki;
+}
+
+void ATT_Update(attitude_t* att, const float* gyro, const float* acc, uint32_t stamp)
+{
+	float norm = sqrtf(acc[0] * acc[0] + acc[1] * acc[1] + acc[2] * acc[2]);
+
+	if(!att->initialised)
+	{
+		if(norm == 0.0f)
+			return;
+		levelFromAccel(att, acc);
+		att->stamp = stamp;
+		att->initialised = 1;
+		updateEuler(att, gyro);
+		return;
+	}
+
+	//Wraps cleanly with the 32 bit microsecond counter
+	float dt = (uint32_t)(stamp - att->stamp) * 1e-6f;
+	att->stamp = stamp;
+	if(dt <= 0.0f || dt > ATT_MAX_DT)
+		dt = 1.0f / IMU_ODR_HZ;
+
+	float gx = gyro[0], gy = gyro[1], gz = gyro[2];
+	float q0 = att->q0, q1 = att->q1, q2 = att->q2, q3 = att->q3;
+
+	if(norm > 0.0f)
+	{
+		float ax = acc[0] / norm, ay = acc[1] / norm, az = acc[2] / norm;
+
+		//Gravity direction predicted by the current estimate, in the body frame
+		float vx = 2.0f * (q1 * q3 - q0 * q2);
+		float vy = 2.0f * (q0 * q1 + q2 * q3);
+		float vz = q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3;
+
+		//Error is the rotation from predicted to measured gravity
+		float ex = ay * vz - az * vy;
+		float ey = az * vx - ax * vz;
+		float ez = ax * vy - ay * vx;
+
+		if(att->ki > 0.0f)
+		{
+			att->integral[0] += att->ki * ex * dt;
+			att->integral[1] += att->ki * ey * dt;
+			att->integral[2] += att->ki * ez * dt;
+		}
+
+		gx += att->kp * ex + att->integral[0];
+		gy += att->kp * ey + att->integral[1];
+		gz += att->kp * ez + att->integral[2];
+	}
+
+	//q_dot = 0.5 * q x (0, g)
+	float half_dt = 0.5f * dt;
+	att->q0 = q0 + (-q1 * gx - q2 * gy - q3 * gz) * half_dt;
+	att->q1 = q1 + ( q0 * gx + q2 * gz - q3 * gy) * half_dt;
+	att->q2 = q2 + ( q0 * gy - q1 * gz + q3 * gx) * half_dt;
+	att->q3 = q3 + ( q0 * gz + q1 * gy - q2 * gx) * half_dt;
+
+	norm = 1.0f / sqrtf(att->q0 * att->q0 + att->q1 * att->q1 + att->q2 * att->q2 + att->q3 * att->q3);
+	att->q0 *= norm;
+	att->q1 *= norm;
+	att->q2 *= norm;
+	att->q3 *= norm;
+
+	//Yaw rate uses the raw rate plus the integral term, which holds the bias estimate
+	float rate[3] = {gyro[0] + att->integral[0], gyro[1] + att->integral[1], gyro[2] + att->integral[2]};
+	updateEuler(att, rate);
+}
+
+static void levelFromAccel(attitude_t* att, const float* acc)
+{
+	float roll = atan2f(acc[1], acc[2]);
+	float pitch = atan2f(-acc[0], sqrtf(acc[1] * acc[1] + acc[2] * acc[2]));
+
+	float cr = cosf(roll * 0.5f), sr = sinf(roll * 0.5f);
+	float cp = cosf(pitch * 0.5f), sp = sinf(pitch * 0.5f);
+
+	att->q0 = cr * cp;
+	att->q1 = sr * cp;
+	att->q2 = cr * sp;
+	att->q3 = -sr * sp;
+}
+
+static void updateEuler(attitude_t* att, const float* gyro)
+{
+	float q0 = att->q0, q1 = att->q1, q2 = att->q2, q3 = att->q3;
+
+	att->roll = atan2f(2.0f * (q0 * q1 + q2 * q3), 1.0f - 2.0f * (q1 * q1 + q2 * q2));
+
+	float sinp = 2.0f * (q0 * q2 - q3 * q1);
+	if(sinp > 1.0f)
+		sinp = 1.0f;
+	else if(sinp < -1.0f)
+		sinp = -1.0f;
+	att->pitch = asinf(sinp);
+
+	//Body rate projected on the world vertical, the last row of the rotation matrix
+	att->yaw_rate = 2.0f * (q1 * q3 - q0 * q2) * gyro[0]
+			+ 2.0f * (q0 * q1 + q2 * q3) * gyro[1]
+			+ (q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3) * gyro[2];
+}
@@ -0,0 +1,137 @@
+/*
+ * autotune.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "autotune.h"
+#include "param_store.h"
+#include <usb_proxy.h>
+#include <math.h>
+#include <string.h>
+
+void AT_Start(autotune_t* at, const atConfig* cfg, uint32_t tick)
+{
+	memset(at, 0, sizeof(*at));
+	at->cfg = *cfg;
+	at->state = AT_RUNNING;
+	at->relay = 1;
+	at->start = tick;
+	at->y_max = -INFINITY;
+	at->y_min = INFINITY;
+}
+
+float AT_Step(autotune_t* at, float y, uint32_t tick)
+{
+	if(at->state != AT_RUNNING)
+		return at->cfg.bias;
+
+	if(tick - at->start > at->cfg.timeout)
+	{
+		at->state = AT_FAILED;
+		return at->cfg.bias;
+	}
+
+	if(y > at->y_max)
+		at->y_max = y;
+	if(y < at->y_min)
+		at->y_min = y;
+
+	float error = at->cfg.setpoint - y;
+
+	//Relay with hysteresis, pushes up while below the band and down while above it
+	if(at->relay < 0 && error > at->cfg.hysteresis)
+	{
+		at->relay = 1;
+
+		//A full cycle ends on each switch to +1
+		if(at->last_rise != 0)
+		{
+			at->cycles++;
+			if(at->cycles > at->cfg.discard_cycles)
+			{
+				at->period_sum += (tick - at->last_rise) / 1000.0f;
+				at->amp_sum += (at->y_max - at->y_min) / 2;
+			}
+			if(at->cycles >= at->cfg.discard_cycles + at->cfg.measure_cycles)
+			{
+				float a = at->amp_sum / at->cfg.measure_cycles;
+				at->tu = at->period_sum / at->cfg.measure_cycles;
+				//Describing function of a relay with hysteresis eps has magnitude 4d/(pi*a) and lags by
+				//asin(eps/a). The oscillation sits where the plant gain meets it, Ku = 4d/(pi*sqrt(a^2 - eps^2))
+				float eps = at->cfg.hysteresis;
+				at->ku = a > eps ? 4.0f * at->cfg.amplitude / ((float)M_PI * sqrtf(a * a - eps * eps)) : 0.0f;
+				at->state = at->ku > 0.0f ? AT_DONE : AT_FAILED;
+				return at->cfg.bias;
+			}
+		}
+		at->last_rise = tick | 1;
+		at->y_max = -INFINITY;
+		at->y_min = INFINITY;
+	}
+	else if(at->relay > 0 && error < -at->cfg.hysteresis)
+		at->relay = -1;
+
+	return at->cfg.bias + at->relay * at->cfg.amplitude;
+}
+
+void AT_Compute(autotune_t* at, atRule rule)
+{
+	float kp, ti, td = 0.0f;
+
+	switch(rule)
+	{
+	case AT_RULE_ZN_PID:
+		kp = 0.6f * at->ku;
+		ti = 0.5f * at->tu;
+		td = 0.125f * at->tu;
+		break;
+	case AT_RULE_TYREUS_LUYBEN:
+		kp = at->ku / 3.2f;
+		ti = 2.2f * at->tu;
+		break;
+	default:
+		kp = 0.45f * at->ku;
+		ti = at->tu / 1.2f;
+		break;
+	}
+
+	//PID_getOutput integrates error * dt in seconds, so I = kp / ti and D = kp * td
+	at->p = kp;
+	at->i = ti > 0.0f ? kp / ti : 0.0f;
+	at->d = kp * td;
+}
+
+uint8_t AT_Report(const autotune_t* at, uint8_t wheel)
+{
+	uint8_t buf[22];
+	buf[0] = AT_TAG_RESULT;
+	buf[1] = wheel;
+	memcpy(&buf[2], &at->ku, 4);
+	memcpy(&buf[6], &at->tu, 4);
+	memcpy(&buf[10], &at->p, 4);
+	memcpy(&buf[14], &at->i, 4);
+	memcpy(&buf[18], &at->d, 4);
+	return USB_Transmit_Cargo(buf, sizeof(buf));
+}
+
+uint8_t AT_Save(const autotune_t* at, uint8_t controller)
+{
+	wheelGains gains = { .version = AT_GAINS_VERSION, .controller = controller };
+	for(int w = 0; w < 2; ++w)
+	{
+		if(at[w].state != AT_DONE)
+			return 0;
+		gains.p[w] = at[w].p;
+		gains.i[w] = at[w].i;
+		gains.d[w] = at[w].d;
+	}
+	return PARAM_Save(PARAM_ID_WHEEL_GAINS, &gains, sizeof(gains));
+}
+
+uint8_t AT_Load(wheelGains* gains, uint8_t controller)
+{
+	return PARAM_Load(PARAM_ID_WHEEL_GAINS, gains, sizeof(*gains))
+			&& gains->version == AT_GAINS_VERSION && gains->controller == controller;
+}
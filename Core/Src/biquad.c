@@ -0,0 +1,142 @@
+/*
+ * biquad.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "biquad.h"
+#include "stm32f4xx_hal.h"
+#include "mem_sections.h"
+#include <math.h>
+#include <string.h>
+
+#ifdef ARM_MATH_CM4
+#include <arm_math.h>
+#endif
+
+void BQ_Init(biquadFilter* filter, uint8_t num_stages)
+{
+	if(num_stages > BIQUAD_MAX_STAGES)
+		num_stages = BIQUAD_MAX_STAGES;
+
+	memset(filter, 0, sizeof(*filter));
+	filter->inst.num_stages = num_stages;
+	filter->inst.state = filter->state;
+	filter->inst.coeffs = filter->coeffs;
+
+	for(int i = 0; i < num_stages; ++i)
+		filter->coeffs[5 * i] = 1.0f;
+}
+
+void BQ_Configure(biquadFilter* filter, uint8_t stage, biquadType type, float fs, float f0, float q)
+{
+	if(stage >= filter->inst.num_stages)
+		return;
+
+	float* c = &filter->coeffs[5 * stage];
+	if(type == BQ_PASS || f0 <= 0.0f || f0 >= fs / 2)
+	{
+		c[0] = 1.0f;
+		c[1] = c[2] = c[3] = c[4] = 0.0f;
+		return;
+	}
+
+	float w0 = 2.0f * (float)M_PI * f0 / fs;
+	float cos_w0 = cosf(w0);
+	float alpha = sinf(w0) / (2.0f * q);
+	float a0 = 1.0f + alpha;
+	float b0, b1, b2;
+
+	if(type == BQ_LOWPASS)
+	{
+		b0 = (1.0f - cos_w0) / 2.0f;
+		b1 = 1.0f - cos_w0;
+		b2 = b0;
+	}
+	else
+	{
+		b0 = 1.0f;
+		b1 = -2.0f * cos_w0;
+		b2 = 1.0f;
+	}
+
+	c[0] = b0 / a0;
+	c[1] = b1 / a0;
+	c[2] = b2 / a0;
+	//CMSIS convention, feedback coefficients are stored negated
+	c[3] = 2.0f * cos_w0 / a0;
+	c[4] = -(1.0f - alpha) / a0;
+}
+
+void BQ_Reset(biquadFilter* filter, float value)
+{
+	for(uint32_t i = 0; i < filter->inst.num_stages; ++i)
+	{
+		const float* c = &filter->coeffs[5 * i];
+		float* s = &filter->state[4 * i];
+		float den = 1.0f - c[3] - c[4];
+		float out = den != 0.0f ? value * (c[0] + c[1] + c[2]) / den : 0.0f;
+
+		s[0] = s[1] = value;
+		s[2] = s[3] = out;
+		value = out;
+	}
+}
+
+RAMFUNC void BQ_Process(biquadFilter* filter, const float* in, float* out, uint32_t block_size)
+{
+#ifdef ARM_MATH_CM4
+	arm_biquad_cascade_df1_f32((arm_biquad_casd_df1_inst_f32*)&filter->inst, (float32_t*)in, out, block_size);
+#else
+	const float* src = in;
+
+	for(uint32_t stage = 0; stage < filter->inst.num_stages; ++stage)
+	{
+		const float* c = &filter->coeffs[5 * stage];
+		float* s = &filter->state[4 * stage];
+		float b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+		float x1 = s[0], x2 = s[1], y1 = s[2], y2 = s[3];
+
+		//Later stages work in place on out
+		for(uint32_t n = 0; n < block_size; ++n)
+		{
+			float x0 = src[n];
+			float y0 = b0 * x0 + b1 * x1 + b2 * x2 + a1 * y1 + a2 * y2;
+			x2 = x1;
+			x1 = x0;
+			y2 = y1;
+			y1 = y0;
+			out[n] = y0;
+		}
+
+		s[0] = x1;
+		s[1] = x2;
+		s[2] = y1;
+		s[3] = y2;
+		src = out;
+	}
+
+	if(filter->inst.num_stages == 0 && in != out)
+		memcpy(out, in, block_size * sizeof(float));
+#endif
+}
+
+RAMFUNC float BQ_Step(biquadFilter* filter, float in)
+{
+	float out;
+	BQ_Process(filter, &in, &out, 1);
+	return out;
+}
+
+float BQ_Benchmark(biquadFilter* filter, float* buf, uint32_t block_size)
+{
+	for(uint32_t n = 0; n < block_size; ++n)
+		buf[n] = (n & 1) ? 1.0f : -1.0f;
+
+	uint32_t start = DWT->CYCCNT;
+	BQ_Process(filter, buf, buf, block_size);
+	uint32_t cycles = DWT->CYCCNT - start;
+
+	return (float)cycles / block_size;
+}
@@ -0,0 +1,134 @@
+/*
+ * clock_profile.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "clock_profile.h"
+#include "main.h"
+
+#define USB_CLOCK_HZ			48000000
+
+//HSE is 8MHz, /4 puts 2MHz into the VCO for the lowest jitter
+const clkProfileConfig clk_profiles[CLK_PROFILE_COUNT] = {
+	[CLK_PROFILE_LOW_POWER] = {
+			.sysclk = 72000000,
+			.pllm = 4, .plln = 72, .pllp = RCC_PLLP_DIV2, .pllq = 3,
+			.voltage_scale = PWR_REGULATOR_VOLTAGE_SCALE3, .overdrive = 0,
+			.prefetch = 0, .flash_latency = FLASH_LATENCY_2,
+			.apb1_div = RCC_HCLK_DIV2, .apb2_div = RCC_HCLK_DIV1,
+	},
+	[CLK_PROFILE_PERFORMANCE] = {
+			.sysclk = 168000000,
+			.pllm = 4, .plln = 168, .pllp = RCC_PLLP_DIV2, .pllq = 7,
+			.voltage_scale = PWR_REGULATOR_VOLTAGE_SCALE1, .overdrive = 0,
+			.prefetch = 1, .flash_latency = FLASH_LATENCY_5,
+			.apb1_div = RCC_HCLK_DIV4, .apb2_div = RCC_HCLK_DIV2,
+	},
+	//360MHz VCO has no integer divider to 48MHz, /8 keeps the 48MHz domain under its limit
+	[CLK_PROFILE_MAX] = {
+			.sysclk = 180000000,
+			.pllm = 4, .plln = 180, .pllp = RCC_PLLP_DIV2, .pllq = 8,
+			.voltage_scale = PWR_REGULATOR_VOLTAGE_SCALE1, .overdrive = 1,
+			.prefetch = 1, .flash_latency = FLASH_LATENCY_5,
+			.apb1_div = RCC_HCLK_DIV4, .apb2_div = RCC_HCLK_DIV2,
+	},
+};
+
+clkProfile clk_profile = CLK_PROFILE_LOW_POWER;
+
+static void configure_art(uint8_t prefetch)
+{
+	//The caches may only be reset while disabled. Flush whatever was fetched at the old wait states
+	__HAL_FLASH_INSTRUCTION_CACHE_DISABLE();
+	__HAL_FLASH_DATA_CACHE_DISABLE();
+	__HAL_FLASH_INSTRUCTION_CACHE_RESET();
+	__HAL_FLASH_DATA_CACHE_RESET();
+	__HAL_FLASH_INSTRUCTION_CACHE_ENABLE();
+	__HAL_FLASH_DATA_CACHE_ENABLE();
+
+	if(prefetch)
+		__HAL_FLASH_PREFETCH_BUFFER_ENABLE();
+	else
+		__HAL_FLASH_PREFETCH_BUFFER_DISABLE();
+}
+
+void CLK_Configure(clkProfile profile)
+{
+	const clkProfileConfig* config = &clk_profiles[profile];
+	RCC_OscInitTypeDef osc = { 0 };
+	RCC_ClkInitTypeDef clk = { 0 };
+
+	__HAL_RCC_PWR_CLK_ENABLE();
+	__HAL_PWR_VOLTAGESCALING_CONFIG(config->voltage_scale);
+
+	osc.OscillatorType = RCC_OSCILLATORTYPE_HSE;
+	osc.HSEState = RCC_HSE_ON;
+	osc.PLL.PLLState = RCC_PLL_ON;
+	osc.PLL.PLLSource = RCC_PLLSOURCE_HSE;
+	osc.PLL.PLLM = config->pllm;
+	osc.PLL.PLLN = config->plln;
+	osc.PLL.PLLP = config->pllp;
+	osc.PLL.PLLQ = config->pllq;
+	if(HAL_RCC_OscConfig(&osc) != HAL_OK)
+		Error_Handler();
+
+	//Over-drive has to be on before the PLL is selected as the system clock
+	if(config->overdrive && HAL_PWREx_EnableOverDrive() != HAL_OK)
+		Error_Handler();
+
+	clk.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK
+			| RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+	clk.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
+	clk.AHBCLKDivider = RCC_SYSCLK_DIV1;
+	clk.APB1CLKDivider = config->apb1_div;
+	clk.APB2CLKDivider = config->apb2_div;
+	if(HAL_RCC_ClockConfig(&clk, config->flash_latency) != HAL_OK)
+		Error_Handler();
+
+	configure_art(config->prefetch);
+	clk_profile = profile;
+}
+
+//Clock of the APB bus a peripheral sits on, by its address
+static uint32_t bus_clock(uintptr_t instance, uint8_t* divided)
+{
+	if(instance >= APB2PERIPH_BASE)
+	{
+		*divided = (RCC->CFGR & RCC_CFGR_PPRE2) != 0;
+		return HAL_RCC_GetPCLK2Freq();
+	}
+	*divided = (RCC->CFGR & RCC_CFGR_PPRE1) != 0;
+	return HAL_RCC_GetPCLK1Freq();
+}
+
+uint32_t CLK_TimerClock(const TIM_TypeDef* tim)
+{
+	uint8_t divided;
+	uint32_t pclk = bus_clock((uintptr_t)tim, &divided);
+	return divided ? 2 * pclk : pclk;
+}
+
+uint32_t CLK_TimerPrescaler(const TIM_TypeDef* tim, uint32_t count_hz)
+{
+	return CLK_TimerClock(tim) / count_hz - 1;
+}
+
+uint32_t CLK_SpiPrescaler(const SPI_TypeDef* spi, uint32_t max_hz)
+{
+	uint8_t divided;
+	uint32_t pclk = bus_clock((uintptr_t)spi, &divided);
+
+	//BR field: divider 2 << BR
+	uint32_t br = 0;
+	while(br < 7 && (pclk >> (br + 1)) > max_hz)
+		br++;
+	return br << SPI_CR1_BR_Pos;
+}
+
+uint8_t CLK_UsbClockValid(void)
+{
+	const clkProfileConfig* config = &clk_profiles[clk_profile];
+	return HSE_VALUE / config->pllm * config->plln / config->pllq == USB_CLOCK_HZ;
+}
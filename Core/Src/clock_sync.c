@@ -0,0 +1,99 @@
+/*
+ * clock_sync.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "clock_sync.h"
+#include "timebase.h"
+#include "main.h"
+#include "trace.h"
+#include <string.h>
+
+clockSync_t clock_sync;
+
+void SYNC_Init(clockSync_t* sync)
+{
+	memset(sync, 0, sizeof(*sync));
+	sync->min_delay = UINT32_MAX;
+}
+
+void SYNC_Ping(clockSync_t* sync, uint32_t seq, uint64_t t1, uint32_t prev_seq, uint64_t t4,
+		uint32_t t2, uint64_t now)
+{
+	//Complete the exchange of the previous ping if its pong went out and the host saw it
+	if(t4 != 0 && prev_seq == sync->seq && sync->pong_seq == sync->seq && sync->t1 != 0)
+	{
+		uint64_t m2 = TB_Extend(sync->t2, now);
+		uint64_t m3 = TB_Extend(sync->t3, now);
+		int64_t round_trip = (int64_t)(t4 - sync->t1) - (int64_t)(m3 - m2);
+
+		if(round_trip >= 0)
+		{
+			sync->delay = (uint32_t)round_trip;
+			if(sync->delay < sync->min_delay)
+				sync->min_delay = sync->delay;
+		}
+
+		//Queued or retried exchanges have asymmetric delays, only trust those close to the best
+		if(round_trip < 0 || sync->delay > sync->min_delay + SYNC_DELAY_MARGIN)
+			sync->rejected++;
+		else
+		{
+			//Host minus MCU time, taken at the midpoint of the MCU side of the exchange
+			int64_t sample = ((int64_t)(sync->t1 - m2) + (int64_t)(t4 - m3)) / 2;
+			uint64_t at = m2 + (m3 - m2) / 2;
+
+			if(sync->exchanges == 0)
+				sync->offset = sample;
+			else
+			{
+				//Tracking loop on the predicted offset, the drift follows the residual slope
+				float dt = (float)(int64_t)(at - sync->ref);
+				int64_t predicted = sync->offset + (int64_t)(sync->drift * dt);
+				float error = (float)(sample - predicted);
+				sync->offset = predicted + (int64_t)(SYNC_OFFSET_GAIN * error);
+				if(dt > 0)
+					sync->drift += SYNC_DRIFT_GAIN * error / dt;
+			}
+			sync->ref = at;
+			sync->exchanges++;
+			TRACE_Event(TRACE_EV_SYNC, sync->delay, (uint32_t)sync->offset);
+		}
+	}
+
+	//The telemetry interrupt echoes seq and t2, keep the pair consistent
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	sync->t1 = t1;
+	sync->t2 = t2;
+	sync->seq = seq;
+	__set_PRIMASK(primask);
+}
+
+void SYNC_Pong(clockSync_t* sync, uint32_t t3)
+{
+	uint32_t seq = sync->seq;
+	if(sync->pong_seq != seq)
+	{
+		sync->t3 = t3;
+		sync->pong_seq = seq;
+	}
+}
+
+uint64_t SYNC_ToHost(const clockSync_t* sync, uint64_t mcu)
+{
+	if(sync->exchanges == 0)
+		return 0;
+	float dt = (float)(int64_t)(mcu - sync->ref);
+	return mcu + sync->offset + (int64_t)(sync->drift * dt);
+}
+
+uint64_t SYNC_ToMcu(const clockSync_t* sync, uint64_t host)
+{
+	//Offset at the host time, one step is enough for drifts of a few hundred ppm
+	uint64_t guess = host - sync->offset;
+	float dt = (float)(int64_t)(guess - sync->ref);
+	return host - sync->offset - (int64_t)(sync->drift * dt);
+}
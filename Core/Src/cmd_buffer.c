@@ -0,0 +1,140 @@
+/*
+ * cmd_buffer.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "cmd_buffer.h"
+#include "main.h"
+#include "mem_sections.h"
+#include <math.h>
+#include <string.h>
+
+CCMRAM_BSS cmdBuffer_t cmd_buffer;
+
+/**
+ * \brief Drop queued commands at or after a time, they are replaced by newer ones
+ * \param [in]      buf pointer to buffer
+ * \param [in]      stamp first time to drop [us]
+ */
+static void drop_from(cmdBuffer_t* buf, uint32_t stamp)
+{
+	uint32_t head = buf->head;
+	while(head != buf->tail
+			&& (int32_t)(buf->points[(head - 1) & (CMD_BUFFER_SIZE - 1)].stamp - stamp) >= 0)
+		head--;
+	buf->head = head;
+}
+
+void CMD_Init(cmdBuffer_t* buf)
+{
+	memset(buf, 0, sizeof(*buf));
+	buf->delay = CMD_MIN_DELAY;
+}
+
+uint8_t CMD_Push(cmdBuffer_t* buf, const cmdPoint* point)
+{
+	uint32_t head = buf->head;
+	if(head - buf->tail >= CMD_BUFFER_SIZE)
+	{
+		buf->overflows++;
+		return 0;
+	}
+
+	buf->points[head & (CMD_BUFFER_SIZE - 1)] = *point;
+	//Entry must be written before the consumer can see it
+	__DMB();
+	buf->head = head + 1;
+	return 1;
+}
+
+uint8_t CMD_PushArrival(cmdBuffer_t* buf, uint32_t arrival, float left, float right)
+{
+	if(buf->last_arrival != 0)
+	{
+		float interval = (float)(arrival - buf->last_arrival);
+		if(buf->interval == 0)
+			buf->interval = interval;
+		//Slow averages, one late frame should not move the delay much
+		buf->jitter += (fabsf(interval - buf->interval) - buf->jitter) / 16;
+		buf->interval += (interval - buf->interval) / 16;
+
+		float delay = buf->interval + CMD_JITTER_MARGIN * buf->jitter;
+		buf->delay = (uint32_t)fminf(fmaxf(delay, CMD_MIN_DELAY), CMD_MAX_DELAY);
+	}
+	else
+		buf->delay = CMD_MIN_DELAY;
+	buf->last_arrival = arrival | 1;
+
+	//A live command overrides anything still scheduled
+	drop_from(buf, arrival);
+	cmdPoint point = { .stamp = arrival, .left = left, .right = right };
+	return CMD_Push(buf, &point);
+}
+
+uint32_t CMD_PushSchedule(cmdBuffer_t* buf, const cmdPoint* points, uint32_t count)
+{
+	drop_from(buf, points[0].stamp);
+
+	//Stamps are already the playback times, an arrival stream starts its estimate again
+	buf->delay = 0;
+	buf->last_arrival = 0;
+	buf->interval = 0;
+	buf->jitter = 0;
+
+	uint32_t queued = 0;
+	while(queued < count && CMD_Push(buf, &points[queued]))
+		queued++;
+	return queued;
+}
+
+uint8_t CMD_Sample(cmdBuffer_t* buf, uint32_t now, float* left, float* right)
+{
+	uint32_t play = now - buf->delay;
+	uint32_t head = buf->head;
+	__DMB();
+
+	//Consume every point the playback time has reached
+	while(buf->tail != head
+			&& (int32_t)(buf->points[buf->tail & (CMD_BUFFER_SIZE - 1)].stamp - play) <= 0)
+	{
+		buf->prev = buf->points[buf->tail & (CMD_BUFFER_SIZE - 1)];
+		buf->have_prev = 1;
+		buf->tail++;
+	}
+
+	//Stream restarted after a pause, do not interpolate from the stale command
+	if(buf->have_prev && buf->tail != head
+			&& buf->points[buf->tail & (CMD_BUFFER_SIZE - 1)].stamp - buf->prev.stamp > CMD_RESTART_GAP)
+		buf->have_prev = 0;
+
+	if(!buf->have_prev)
+	{
+		buf->state = CMD_EMPTY;
+		return 0;
+	}
+
+	const cmdPoint* a = &buf->prev;
+	float elapsed = (float)(int32_t)(play - a->stamp);
+
+	if(buf->tail != head)
+	{
+		//Between the last reached point and the next one
+		const cmdPoint* b = &buf->points[buf->tail & (CMD_BUFFER_SIZE - 1)];
+		//Clamped since a growing delay can move the playback time back before the last point
+		float t = fmaxf(elapsed, 0) / (float)(int32_t)(b->stamp - a->stamp);
+		*left = a->left + t * (b->left - a->left);
+		*right = a->right + t * (b->right - a->right);
+		buf->state = CMD_INTERPOLATING;
+	}
+	else
+	{
+		//Next command is late or the stream ended. Hold the last one exactly, a slope carried on
+		//past it overshoots the final value and can run through zero into reverse
+		*left = a->left;
+		*right = a->right;
+		buf->state = CMD_HOLDING;
+	}
+	return 1;
+}
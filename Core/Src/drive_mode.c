@@ -0,0 +1,93 @@
+/*
+ * drive_mode.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "drive_mode.h"
+#include <main.h>
+#include <trace.h>
+
+drive_t drive;
+
+void DRIVE_Init(drive_t* drv)
+{
+	drv->source = DRIVE_IDLE;
+	drv->linear = 0.0f;
+	drv->angular = 0.0f;
+	drv->centred_since = 0;
+	drv->arm_since = 0;
+	drv->joy_armed = 0;
+	drv->switches = 0;
+}
+
+void DRIVE_Update(drive_t* drv, const joystick_t* joy, float ros_left, float ros_right,
+		uint32_t ros_tick, uint8_t e_stop, uint32_t tick)
+{
+	driveSource source = DRIVE_IDLE;
+	uint8_t joy_alive = JOY_Alive(joy, tick);
+	uint8_t centred = joy_alive && joy->axis[DRIVE_JOY_LINEAR_AXIS] == 0.0f
+			&& joy->axis[DRIVE_JOY_ANGULAR_AXIS] == 0.0f;
+
+#ifdef JOYSTICK_DRIVE
+	//A stick that is missing, floating or off its calibration does not read centred for long, so it
+	//never arms. One held over at power up has to be let go first
+	if(!joy_alive)
+	{
+		drv->joy_armed = 0;
+		drv->arm_since = 0;
+	}
+	else if(!drv->joy_armed)
+	{
+		if(!centred)
+			drv->arm_since = 0;
+		else if(drv->arm_since == 0)
+			drv->arm_since = tick | 1;
+		else if(tick - drv->arm_since >= DRIVE_ARM_TIME)
+			drv->joy_armed = 1;
+	}
+#endif
+	uint8_t deflected = drv->joy_armed && !centred;
+
+	if(deflected)
+		drv->centred_since = 0;
+	else if(drv->centred_since == 0)
+		drv->centred_since = tick | 1;
+
+	uint8_t ros_fresh = ros_tick != 0 && tick - ros_tick <= DRIVE_ROS_TIMEOUT;
+
+	//The person in the chair always wins. After letting go the chair holds still for
+	//DRIVE_RELEASE_TIME before ROS takes over again, so a stale plan does not lurch away
+	if(e_stop)
+		source = DRIVE_IDLE;
+	else if(deflected)
+		source = DRIVE_JOYSTICK;
+	else if(drv->source == DRIVE_JOYSTICK && tick - drv->centred_since < DRIVE_RELEASE_TIME)
+		source = DRIVE_JOYSTICK;
+	else if(ros_fresh)
+		source = DRIVE_ROS;
+
+	if(source != drv->source)
+	{
+		drv->switches++;
+		TRACE_Event(TRACE_EV_SOURCE, source, drv->source);
+	}
+	drv->source = source;
+
+	switch(source)
+	{
+	case DRIVE_JOYSTICK:
+		drv->linear = joy->axis[DRIVE_JOY_LINEAR_AXIS] * DRIVE_JOY_MAX_LINEAR;
+		drv->angular = joy->axis[DRIVE_JOY_ANGULAR_AXIS] * DRIVE_JOY_MAX_ANGULAR;
+		break;
+	case DRIVE_ROS:
+		drv->linear = (ros_left + ros_right) / 2;
+		drv->angular = (ros_right - ros_left) / BASE_WIDTH;
+		break;
+	default:
+		drv->linear = 0.0f;
+		drv->angular = 0.0f;
+		break;
+	}
+}
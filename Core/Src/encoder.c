@@ -1,5 +1,6 @@
 #include <encoder.h>
 #include <math.h>
+#include <trace.h>
 //#include <dwt_delay.h>
 
 #define MOVING_AVERAGE_SIZE 20
@@ -15,6 +16,8 @@ uint32_t prev_time = 0;
 double unfiltered_vel[2]= {0, 0};
 double filtered_vel[2]= {0, 0};
 
+encoderStatus encoder_status[2];
+
 // Read Position
 // Hex command sequence: 0x00 0x00
 // Reset Encoder
@@ -22,41 +25,110 @@ double filtered_vel[2]= {0, 0};
 // Set Zero Point
 // Hex command sequence: 0x00 0x70
 
-void encoderRead(uint16_t *encoder_vals)
+//Read a single 2 byte frame from an encoder
+//Returns HAL_OK only if both bytes were transferred
+static HAL_StatusTypeDef encoderTransfer(SPI_HandleTypeDef *hspi, GPIO_TypeDef *cs_port, uint16_t cs_pin, uint16_t *frame)
 {
 	uint8_t SPItransmit[2] = {0x00, 0x00};
-	uint8_t receive_buff[2];
-	uint16_t temp;
+	uint8_t receive_buff[2] = {0, 0};
+	HAL_StatusTypeDef status;
 
-	// Encoder 2
-	ENCODER2_CS_LOW;
+	HAL_GPIO_WritePin(cs_port, cs_pin, GPIO_PIN_RESET);
 
 	//Delay required as encoder is only readable after 25us from chip select low
 //	DWT_Delay(4);
-	HAL_SPI_TransmitReceive(&hspi6, &SPItransmit[0], &receive_buff[0], 1, 1);
+	status = HAL_SPI_TransmitReceive(hspi, &SPItransmit[0], &receive_buff[0], 1, ENCODER_SPI_TIMEOUT);
 
 	//Delay required between bytes
 //	DWT_Delay(4);
-	HAL_SPI_TransmitReceive(&hspi6, &SPItransmit[1], &receive_buff[1], 1, 1);
+	if(status == HAL_OK)
+		status = HAL_SPI_TransmitReceive(hspi, &SPItransmit[1], &receive_buff[1], 1, ENCODER_SPI_TIMEOUT);
 
 	//There is also a required delay before releasing the CS line
 //	DWT_Delay(4);
-	ENCODER2_CS_HIGH;
-	temp = (uint16_t)receive_buff[0]<< 8 | receive_buff[1];
+	HAL_GPIO_WritePin(cs_port, cs_pin, GPIO_PIN_SET);
+
+	*frame = (uint16_t)receive_buff[0] << 8 | receive_buff[1];
+	return status;
+}
+
+//The 2 MSB are check bits K1 and K0. K1 is odd parity over the odd position bits,
+//K0 is odd parity over the even position bits. A floating or stuck MISO line
+//(0x0000 or 0xFFFF) fails both checks
+static uint8_t encoderChecksumValid(uint16_t frame)
+{
+	return __builtin_parity(frame & 0xAAAA) && __builtin_parity(frame & 0x5555);
+}
+
+//Validate one frame, update fault accounting and return the position to use
+static uint16_t encoderAccept(encoderStatus *status, HAL_StatusTypeDef transfer, uint16_t frame, uint8_t *valid)
+{
+	uint16_t position;
+
+	if(transfer == HAL_OK && encoderChecksumValid(frame))
+	{
+		//Remove checksum bits (2 MSB bits)
+		position = frame & 0x3FFF;
+
+		if(status->has_position)
+		{
+			int16_t delta = position - status->last_position;
+			if(delta < -ENCODER_MAX / 2)
+				delta += ENCODER_MAX;
+			else if(delta > ENCODER_MAX / 2)
+				delta -= ENCODER_MAX;
+
+			//After a run of faults the difference spans several ticks, do not extrapolate with it
+			status->last_delta = (status->consecutive_faults == 0) ? delta : 0;
+		}
+
+		status->has_position = 1;
+		status->consecutive_faults = 0;
+		*valid = 1;
+	}
+
+	else
+	{
+		if(transfer != HAL_OK)
+			status->timeout_count++;
+		else
+			status->error_count++;
+
+		if(status->consecutive_faults == 0)
+			TRACE_Event(TRACE_EV_ENCODER, status - encoder_status, transfer | (uint32_t)frame << 16);
+		if(status->consecutive_faults < UINT16_MAX)
+			status->consecutive_faults++;
+		if(status->consecutive_faults > status->max_consecutive_faults)
+			status->max_consecutive_faults = status->consecutive_faults;
+
+		//Extrapolate with the last known speed for a few ticks, then hold the position
+		if(status->consecutive_faults <= ENCODER_MAX_EXTRAPOLATE)
+			position = (uint16_t)(status->last_position + status->last_delta) & 0x3FFF;
+		else
+			position = status->last_position;
+
+		*valid = 0;
+	}
+
+	status->last_position = position;
+	return position;
+}
+
+uint8_t encoderRead(uint16_t *encoder_vals)
+{
+	uint16_t frame;
+	HAL_StatusTypeDef transfer;
+	uint8_t valid_right, valid_left;
+
+	// Encoder 2
+	transfer = encoderTransfer(&hspi6, ENCODER2_CS_PORT, ENCODER2_CS_PIN, &frame);
+	encoder_vals[RIGHT_INDEX] = encoderAccept(&encoder_status[RIGHT_INDEX], transfer, frame, &valid_right);
 
-	//Remove checksum bits (2 MSB bits)
-	encoder_vals[RIGHT_INDEX] = temp & 0x3FFF;
-	
 	// Encoder 1
-	ENCODER1_CS_LOW;
-//	DWT_Delay(4);
-	HAL_SPI_TransmitReceive(&hspi1, &SPItransmit[0], &receive_buff[0], 1, 1);
-//	DWT_Delay(4);
-	HAL_SPI_TransmitReceive(&hspi1, &SPItransmit[1], &receive_buff[1], 1, 1);
-//	DWT_Delay(4);
-	ENCODER1_CS_HIGH;
-	temp = (uint16_t)receive_buff[0]<< 8 | receive_buff[1];
-	encoder_vals[LEFT_INDEX] = temp & 0x3FFF;
+	transfer = encoderTransfer(&hspi1, ENCODER1_CS_PORT, ENCODER1_CS_PIN, &frame);
+	encoder_vals[LEFT_INDEX] = encoderAccept(&encoder_status[LEFT_INDEX], transfer, frame, &valid_left);
+
+	return (valid_left << LEFT_INDEX) | (valid_right << RIGHT_INDEX);
 }
 
 void calcVelFromEncoder(uint16_t *encoder_vals, double *velocities)
@@ -100,8 +172,8 @@ void calcVelFromEncoder(uint16_t *encoder_vals, double *velocities)
 //	if(fabs(velocities[LEFT_INDEX]) < 0.01)
 //		velocities[LEFT_INDEX] = 0.000;
 
-	// Sometimes data gets lost and spikes are seen in the velocity readouts.
-	// This is solved by limiting the max difference between subsequent velocity readouts.
+	// Corrupted frames are rejected in encoderRead, but a spike can still come from a
+	// frame that passes the checksum. Limit the max difference between subsequent velocity readouts.
 	// If acceleration is passed, just update velocity within acceleration limits
 	double right_acc = (velocities[RIGHT_INDEX] - velocities_prev[RIGHT_INDEX]) / dt;
 	double left_acc = (velocities[LEFT_INDEX] - velocities_prev[LEFT_INDEX]) / dt;
@@ -0,0 +1,60 @@
+/*
+ * feedforward.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "feedforward.h"
+#include <math.h>
+#include <stddef.h>
+
+static const ffTable* active[2][2];
+
+static float lookup(const ffTable* table, float speed);
+
+void FF_Init(uint8_t controller)
+{
+	for(int wheel = 0; wheel < 2; ++wheel)
+		for(int dir = 0; dir < 2; ++dir)
+			active[wheel][dir] = &ff_tables[controller][wheel][dir];
+}
+
+void FF_SetTable(uint8_t wheel, uint8_t direction, const ffTable* table)
+{
+	if(wheel < 2 && direction < 2 && table != NULL && table->size > 0)
+		active[wheel][direction] = table;
+}
+
+float FF_Gain(uint8_t wheel, float setpoint)
+{
+	if(setpoint >= 0.0f)
+		return lookup(active[wheel][FF_FORWARD], setpoint);
+	return lookup(active[wheel][FF_REVERSE], -setpoint);
+}
+
+float FF_VoltsToCommand(float volts)
+{
+	return volts * (FF_COMMAND_FULL_SCALE / (FF_SUPPLY_VOLTS * FF_DRIVER_EFFICIENCY));
+}
+
+float FF_CommandToVolts(float command)
+{
+	command = fminf(fmaxf(command, -FF_COMMAND_FULL_SCALE), FF_COMMAND_FULL_SCALE);
+	return command * (FF_SUPPLY_VOLTS * FF_DRIVER_EFFICIENCY / FF_COMMAND_FULL_SCALE);
+}
+
+static float lookup(const ffTable* table, float speed)
+{
+	//Uniform grid, the index is a multiply away. Speeds off the grid hold the end values
+	float x = (speed - table->speed_min) * table->inv_step;
+	if(x <= 0.0f)
+		return table->gain[0];
+
+	uint32_t i = (uint32_t)x;
+	if(i >= table->size - 1u)
+		return table->gain[table->size - 1];
+
+	float frac = x - (float)i;
+	return table->gain[i] + frac * (table->gain[i + 1] - table->gain[i]);
+}
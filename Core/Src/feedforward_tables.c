@@ -0,0 +1,74 @@
+/*
+ * feedforward_tables.c
+ *
+ * Generated by script/gen_feedforward.py from script/feedforward.csv, do not edit
+ */
+
+#include "feedforward.h"
+
+static const float by_left_fwd[31] = {
+		500.0000f, 500.0000f, 500.0000f, 475.0000f, 450.0000f, 433.3333f, 416.6667f, 400.0000f,
+		383.3333f, 366.6667f, 350.0000f, 342.5000f, 335.0000f, 327.5000f, 320.0000f, 320.0000f,
+		320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f,
+		320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f,
+};
+
+static const float by_left_rev[31] = {
+		500.0000f, 500.0000f, 500.0000f, 475.0000f, 450.0000f, 433.3333f, 416.6667f, 400.0000f,
+		383.3333f, 366.6667f, 350.0000f, 342.5000f, 335.0000f, 327.5000f, 320.0000f, 320.0000f,
+		320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f,
+		320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f,
+};
+
+static const float by_right_fwd[31] = {
+		500.0000f, 500.0000f, 500.0000f, 475.0000f, 450.0000f, 433.3333f, 416.6667f, 400.0000f,
+		383.3333f, 366.6667f, 350.0000f, 342.5000f, 335.0000f, 327.5000f, 320.0000f, 320.0000f,
+		320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f,
+		320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f,
+};
+
+static const float by_right_rev[31] = {
+		500.0000f, 500.0000f, 500.0000f, 475.0000f, 450.0000f, 433.3333f, 416.6667f, 400.0000f,
+		383.3333f, 366.6667f, 350.0000f, 342.5000f, 335.0000f, 327.5000f, 320.0000f, 320.0000f,
+		320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f,
+		320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f, 320.0000f,
+};
+
+static const float cx_left_fwd[31] = {
+		11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f,
+		11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f,
+		11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f,
+		11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f,
+};
+
+static const float cx_left_rev[31] = {
+		11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f,
+		11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f,
+		11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f,
+		11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f,
+};
+
+static const float cx_right_fwd[31] = {
+		11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f,
+		11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f,
+		11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f,
+		11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f,
+};
+
+static const float cx_right_rev[31] = {
+		11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f,
+		11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f,
+		11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f,
+		11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f, 11.1382f,
+};
+
+const ffTable ff_tables[FF_CONTROLLERS][2][2] = {
+		{
+				{{0.0000f, 20.0000f, 31, by_left_fwd}, {0.0000f, 20.0000f, 31, by_left_rev}},
+				{{0.0000f, 20.0000f, 31, by_right_fwd}, {0.0000f, 20.0000f, 31, by_right_rev}},
+		},
+		{
+				{{0.0000f, 20.0000f, 31, cx_left_fwd}, {0.0000f, 20.0000f, 31, cx_left_rev}},
+				{{0.0000f, 20.0000f, 31, cx_right_fwd}, {0.0000f, 20.0000f, 31, cx_right_rev}},
+		},
+};
@@ -0,0 +1,54 @@
+/*
+ * gain_schedule.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "gain_schedule.h"
+#include <math.h>
+
+void GS_Init(gainSchedule_t* gs, const gsTable* accel, const gsTable* decel,
+		float base_p, float base_i)
+{
+	gs->table[GS_ACCEL] = *accel;
+	gs->table[GS_DECEL] = *decel;
+	gs->base_p = base_p;
+	gs->base_i = base_i;
+	gs->direction = GS_ACCEL;
+	gs->speed = 0;
+}
+
+void GS_Apply(gainSchedule_t* gs, PID_Struct* pid, float setpoint, float velocity)
+{
+	float sp = fabsf(setpoint);
+	float v = fabsf(velocity);
+
+	//Accelerating towards the setpoint is scheduled on the target, slowing down on the current speed
+	gs->direction = sp >= v ? GS_ACCEL : GS_DECEL;
+	gs->speed = sp >= v ? sp : v;
+
+	const gsTable* table = &gs->table[gs->direction];
+	const gsPoint* lo = &table->points[0];
+	const gsPoint* hi = lo;
+	float t = 0;
+
+	//Tables are a handful of points, a linear scan is cheaper than anything cleverer
+	if(gs->speed >= table->points[table->size - 1].speed)
+		lo = hi = &table->points[table->size - 1];
+	else if(gs->speed > lo->speed)
+	{
+		while(hi->speed <= gs->speed)
+			lo = hi++;
+		t = (gs->speed - lo->speed) / (hi->speed - lo->speed);
+	}
+
+	float p_scale = lo->p_scale + t * (hi->p_scale - lo->p_scale);
+	float i_scale = lo->i_scale + t * (hi->i_scale - lo->i_scale);
+
+	PID_setPID(pid, gs->base_p * p_scale, gs->base_i * i_scale, pid->D);
+	//Keep the integrator clamp at the same output when I changes
+	PID_setMaxIOutput(pid, pid->maxIOutput);
+	PID_setOutputRampRate(pid, lo->ramp_rate + t * (hi->ramp_rate - lo->ramp_rate));
+	PID_setOutputDescentRate(pid, -(lo->descent_rate + t * (hi->descent_rate - lo->descent_rate)));
+}
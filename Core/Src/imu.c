@@ -4,6 +4,11 @@
 
 extern SPI_HandleTypeDef IMU_SPI;
 
+#define GRAVITY		9.80665f
+
+int16_t imu_acc_raw[3];
+int16_t imu_gyro_raw[3];
+
 void IMU_Init(void)
 {
 	uint8_t rxWhoAmI;
@@ -14,6 +19,9 @@ void IMU_Init(void)
 		__NOP();			// Cannot detect LSM6DS33, do something here if needed
 	}
 
+	//Samples are read in a single burst, block data update keeps both bytes of an axis from the same sample
+	IMU_Reg_Write(SW_RESET_REG, CTRL3_C_BDU | CTRL3_C_IF_INC);
+
 	// Initialize LSM6DS33, sampling rate of 1660Hz
 	IMU_Reg_Write(ACC_CONFIG_REG, ACC_1660_HZ | ACC_FS_2G);
 	IMU_Reg_Write(GYRO_CONFIG_REG, GYRO_1660_HZ | GYRO_500_DPS);
@@ -38,25 +46,23 @@ int IMU_Reg_Read(uint8_t reg, uint8_t *buf, uint8_t size)
 	//MSB of read command byte must be 1
 	reg = reg | READ;
 
-	for(int i = 0; i < size; ++i)
-	{
-		IMU_CS_LOW;
-//		DWT_Delay(4);
-		HAL_SPI_Transmit(&IMU_SPI, &reg, 1, 1);
-//		DWT_Delay(4);
-		HAL_SPI_Receive(&IMU_SPI, &buf[i], 1, 1);
-//		DWT_Delay(4);
-		IMU_CS_HIGH;
-		++reg;
-	}
+	//Register address auto increments (IF_INC), read all bytes in one chip select
+	IMU_CS_LOW;
+//	DWT_Delay(4);
+	HAL_StatusTypeDef status = HAL_SPI_Transmit(&IMU_SPI, &reg, 1, 1);
+//	DWT_Delay(4);
+	if(status == HAL_OK)
+		status = HAL_SPI_Receive(&IMU_SPI, buf, size, 1);
+//	DWT_Delay(4);
+	IMU_CS_HIGH;
 
-	return 1;
+	return status == HAL_OK;
 }
 
-void imuRead(int16_t *acc, int16_t *gyro, double exponentialFilter)
+uint8_t imuRead(void)
 {
 	//Check if data is ready
-	uint8_t dataReady;
+	uint8_t dataReady = 0;
 	uint8_t STATUS_REG = 0x1E;
 	IMU_Reg_Read(STATUS_REG, &dataReady, 1);
 	if(dataReady & 0b010 && dataReady & 0b001){
@@ -68,20 +74,40 @@ void imuRead(int16_t *acc, int16_t *gyro, double exponentialFilter)
 		//All data registers are continuous, first register is GYRO_X_LOW
 		uint8_t GYRO_X_LOW = 0x22;
 		if(!IMU_Reg_Read(GYRO_X_LOW, rxBuff, bytes))
-			return;
+			return 0;
 
 		//Data is in order xyz
-		gyro[0] = gyro[0] * (1.0 - exponentialFilter) + (rxBuff[0] | (int16_t)(rxBuff[1] << 8)) * exponentialFilter;
-		gyro[1] = gyro[1] * (1.0 - exponentialFilter) + (rxBuff[2] | (int16_t)(rxBuff[3] << 8)) * exponentialFilter;
-		gyro[2] = gyro[2] * (1.0 - exponentialFilter) + (rxBuff[4] | (int16_t)(rxBuff[5] << 8)) * exponentialFilter;
+		for(int i = 0; i < 3; ++i)
+		{
+			imu_gyro_raw[i] = (int16_t)(rxBuff[2 * i] | rxBuff[2 * i + 1] << 8);
+			imu_acc_raw[i] = (int16_t)(rxBuff[6 + 2 * i] | rxBuff[7 + 2 * i] << 8);
+		}
+
+		//Likely that IMU is stuck/hanged (z acceleration should be around 16k), attempt to reinitialize IMU.
+		//A single saturated sample is a bump, only a run of them is a hang
+		static uint16_t saturated = 0;
+		if(imu_acc_raw[2] > 32000 || imu_acc_raw[2] < -32000)
+			saturated++;
+		else
+			saturated = 0;
+		if(saturated >= IMU_HANG_SAMPLES)
+		{
+			saturated = 0;
+			IMU_Init();
+		}
 
-		acc[0] = acc[0] * (1.0 - exponentialFilter) + ((int16_t) rxBuff[6] | (int16_t)(rxBuff[7] << 8)) * exponentialFilter;
-		acc[1] = acc[1] * (1.0 - exponentialFilter) + ((int16_t) rxBuff[8] | (int16_t)(rxBuff[9] << 8)) * exponentialFilter;
-		acc[2] = acc[2] * (1.0 - exponentialFilter) + ((int16_t) rxBuff[10] | (int16_t)(rxBuff[11] << 8)) * exponentialFilter;
+		return 1;
+	}
 
-		//Likely that IMU is stuck/hanged (z acceleration acc[2] should be around 16k), attempt to reinitialize IMU
-		if(fabs(acc[2]) > 32000)
-			IMU_Init();
+	return 0;
+}
+
+void imuConvert(const int16_t *acc_raw, const int16_t *gyro_raw, float *acc, float *gyro)
+{
+	for(int i = 0; i < 3; ++i)
+	{
+		acc[i] = acc_raw[i] * ACC_SENSITIVITY_2G * GRAVITY;
+		gyro[i] = gyro_raw[i] * GYRO_SENSITIVITY_500DPS * (float)(M_PI / 180.0);
 	}
 }
 
@@ -0,0 +1,267 @@
+/*
+ * imu_calib.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "imu_calib.h"
+#include "param_store.h"
+#include "usb_proxy.h"
+#include <math.h>
+#include <string.h>
+
+#define GRAVITY		9.80665f
+
+imuCalib_t imu_calib;
+
+static void rotate(const float r[3][3], const float* in, float* out);
+static void capture(imuCalib_t* calib, const float* acc, uint8_t quiet);
+static calibStatus checkFace(imuCalib_t* calib);
+static calibStatus solveFaces(imuCalib_t* calib);
+static calibStatus solveLevel(imuCalib_t* calib);
+
+void CALIB_Init(imuCalib_t* calib)
+{
+	memset(calib, 0, sizeof(*calib));
+
+	calib->loaded = PARAM_Load(PARAM_ID_IMU_CALIB, &calib->params, sizeof(calib->params))
+			&& calib->params.version == CALIB_VERSION;
+
+	if(!calib->loaded)
+	{
+		memset(&calib->params, 0, sizeof(calib->params));
+		calib->params.version = CALIB_VERSION;
+		for(int i = 0; i < 3; ++i)
+		{
+			calib->params.acc_scale[i] = 1.0f;
+			calib->params.rotation[i][i] = 1.0f;
+		}
+	}
+
+	memcpy(calib->gyro_bias, calib->params.gyro_bias, sizeof(calib->gyro_bias));
+}
+
+void CALIB_UpdateStandstill(imuCalib_t* calib, const double* wheel_vel, uint32_t tick)
+{
+	if(fabs(wheel_vel[0]) > CALIB_STILL_VEL || fabs(wheel_vel[1]) > CALIB_STILL_VEL)
+	{
+		calib->still_since = 0;
+		calib->stationary = 0;
+		return;
+	}
+
+	//0 is used as the moving marker
+	if(calib->still_since == 0)
+		calib->still_since = tick | 1;
+
+	calib->stationary = tick - calib->still_since >= CALIB_STILL_TIME;
+}
+
+void CALIB_Apply(imuCalib_t* calib, const float* acc, const float* gyro, float dt)
+{
+	float gyro_corr[3], acc_corr[3];
+
+	//A flash write or a stalled loop must not turn into one huge bias step
+	if(dt > CALIB_MAX_DT)
+		dt = CALIB_MAX_DT;
+
+	uint8_t quiet = 1;
+	for(int i = 0; i < 3; ++i)
+	{
+		gyro_corr[i] = gyro[i] - calib->gyro_bias[i];
+		quiet &= fabsf(gyro_corr[i]) < CALIB_STILL_GYRO;
+		acc_corr[i] = (acc[i] - calib->params.acc_offset[i]) * calib->params.acc_scale[i];
+	}
+
+	//Wheels can be still while someone rocks the chair, only learn when the gyro agrees
+	if(calib->stationary && quiet)
+	{
+		float k = dt / CALIB_BIAS_TAU;
+		for(int i = 0; i < 3; ++i)
+		{
+			calib->gyro_bias[i] += k * gyro_corr[i];
+			gyro_corr[i] = gyro[i] - calib->gyro_bias[i];
+		}
+		calib->bias_time += (uint32_t)(dt * 1000.0f + 0.5f);
+
+		float norm = sqrtf(acc_corr[0] * acc_corr[0] + acc_corr[1] * acc_corr[1] + acc_corr[2] * acc_corr[2]);
+		if(fabsf(norm - GRAVITY) > CALIB_ACC_TOLERANCE * GRAVITY)
+			calib->acc_faults++;
+	}
+
+	//Faces are averaged before offset and scale, the level pose after them
+	if(calib->capturing)
+	{
+		if(calib->pose == CALIB_POSE_LEVEL)
+			capture(calib, acc_corr, quiet && calib->stationary);
+		else
+			capture(calib, acc, quiet);
+	}
+
+	rotate(calib->params.rotation, gyro_corr, calib->gyro);
+	rotate(calib->params.rotation, acc_corr, calib->acc);
+}
+
+void CALIB_Request(imuCalib_t* calib, uint8_t request)
+{
+	if(request == CALIB_REQUEST_SAVE)
+	{
+		calib->capturing = 0;
+		calib->save_requested = 1;
+		return;
+	}
+	if(request >= CALIB_POSE_COUNT)
+		return;
+
+	calib->pose = request;
+	calib->pose_samples = 0;
+	memset(calib->pose_sum, 0, sizeof(calib->pose_sum));
+	calib->capturing = 1;
+}
+
+uint8_t CALIB_Flush(imuCalib_t* calib)
+{
+	static const float none[3];
+	uint8_t buf[16];
+
+	if(!calib->report)
+		return 0;
+
+	buf[0] = CALIB_TAG_RESULT;
+	buf[1] = calib->pose;
+	buf[2] = calib->status;
+	buf[3] = calib->poses_done;
+	memcpy(&buf[4], calib->pose < CALIB_POSE_COUNT ? calib->pose_acc[calib->pose] : none, 12);
+	//Sent again on the next call if the endpoint was busy
+	if(USB_Transmit_Cargo(buf, sizeof(buf)) == USBD_OK)
+		calib->report = 0;
+	return calib->report;
+}
+
+uint8_t CALIB_SaveDue(imuCalib_t* calib)
+{
+	if(calib->save_requested)
+		return 1;
+	if(calib->saved || calib->bias_time < CALIB_BIAS_SETTLE)
+		return 0;
+
+	for(int i = 0; i < 3; ++i)
+		if(fabsf(calib->gyro_bias[i] - calib->params.gyro_bias[i]) > CALIB_SAVE_DELTA)
+			return 1;
+
+	return !calib->loaded;
+}
+
+uint8_t CALIB_Save(imuCalib_t* calib)
+{
+	memcpy(calib->params.gyro_bias, calib->gyro_bias, sizeof(calib->gyro_bias));
+	calib->params.version = CALIB_VERSION;
+
+	//Only one attempt per boot, a failing sector is not retried every loop
+	calib->saved = 1;
+	calib->loaded = PARAM_Save(PARAM_ID_IMU_CALIB, &calib->params, sizeof(calib->params));
+
+	if(calib->save_requested)
+	{
+		calib->save_requested = 0;
+		calib->pose = CALIB_REQUEST_SAVE;
+		calib->status = calib->loaded ? CALIB_OK : CALIB_SAVE_FAILED;
+		calib->report = 1;
+	}
+	return calib->loaded;
+}
+
+static void rotate(const float r[3][3], const float* in, float* out)
+{
+	for(int i = 0; i < 3; ++i)
+		out[i] = r[i][0] * in[0] + r[i][1] * in[1] + r[i][2] * in[2];
+}
+
+static void capture(imuCalib_t* calib, const float* acc, uint8_t quiet)
+{
+	//Handling the board shakes it, start over until it has been put down
+	if(!quiet)
+	{
+		calib->pose_samples = 0;
+		memset(calib->pose_sum, 0, sizeof(calib->pose_sum));
+		return;
+	}
+
+	for(int i = 0; i < 3; ++i)
+		calib->pose_sum[i] += acc[i];
+	if(++calib->pose_samples < CALIB_POSE_SAMPLES)
+		return;
+
+	for(int i = 0; i < 3; ++i)
+		calib->pose_acc[calib->pose][i] = calib->pose_sum[i] / CALIB_POSE_SAMPLES;
+	calib->capturing = 0;
+	calib->status = calib->pose == CALIB_POSE_LEVEL ? solveLevel(calib) : checkFace(calib);
+	calib->report = 1;
+}
+
+static calibStatus checkFace(imuCalib_t* calib)
+{
+	const float* a = calib->pose_acc[calib->pose];
+	int axis = calib->pose / 2;
+	float up = calib->pose & 1 ? -a[axis] : a[axis];
+
+	//The accel reads +g on the axis pointing up, the other two must be close to zero
+	float norm = sqrtf(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+	if(up < 0.95f * norm)
+		return CALIB_WRONG_POSE;
+
+	calib->poses_done |= 1 << calib->pose;
+	if((calib->poses_done & 0x3F) != 0x3F)
+		return CALIB_OK;
+	return solveFaces(calib);
+}
+
+static calibStatus solveFaces(imuCalib_t* calib)
+{
+	float offset[3], scale[3];
+
+	for(int i = 0; i < 3; ++i)
+	{
+		float up = calib->pose_acc[2 * i][i];
+		float down = calib->pose_acc[2 * i + 1][i];
+		float half = (up - down) / 2;
+		if(fabsf(half - GRAVITY) > CALIB_ACC_TOLERANCE * GRAVITY)
+			return CALIB_OUT_OF_RANGE;
+		offset[i] = (up + down) / 2;
+		scale[i] = GRAVITY / half;
+	}
+
+	memcpy(calib->params.acc_offset, offset, sizeof(offset));
+	memcpy(calib->params.acc_scale, scale, sizeof(scale));
+	return CALIB_OK;
+}
+
+static calibStatus solveLevel(imuCalib_t* calib)
+{
+	const float* a = calib->pose_acc[CALIB_POSE_LEVEL];
+	float norm = sqrtf(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+	if(norm < (1.0f - CALIB_ACC_TOLERANCE) * GRAVITY)
+		return CALIB_WRONG_POSE;
+
+	//Shortest rotation taking the measured up direction u onto z: axis v = u x z, cos c = u . z,
+	//R = I + [v]x + [v]x^2 / (1 + c). It adds no yaw of its own
+	float u[3] = { a[0] / norm, a[1] / norm, a[2] / norm };
+	float c = u[2];
+	if(c < cosf(CALIB_MAX_TILT))
+		return CALIB_WRONG_POSE;
+	float v[3] = { u[1], -u[0], 0.0f };
+	float vx[3][3] = {
+			{ 0.0f, -v[2], v[1] },
+			{ v[2], 0.0f, -v[0] },
+			{ -v[1], v[0], 0.0f },
+	};
+	float vv = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+	float k = 1.0f / (1.0f + c);
+	for(int i = 0; i < 3; ++i)
+		for(int j = 0; j < 3; ++j)
+			calib->params.rotation[i][j] = (i == j) + vx[i][j] + k * (v[i] * v[j] - (i == j) * vv);
+
+	calib->poses_done |= 1 << CALIB_POSE_LEVEL;
+	return CALIB_OK;
+}
@@ -0,0 +1,75 @@
+/*
+ * joystick.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "joystick.h"
+
+joystick_t joystick;
+uint16_t joystick_dma[JOY_DMA_LENGTH];
+
+void JOY_Init(joystick_t* joy)
+{
+	for(int i = 0; i < JOY_CHANNELS; ++i)
+	{
+		joy->cal[i].centre = 2048.0f;
+		joy->cal[i].span_pos = 1700.0f;
+		joy->cal[i].span_neg = 1700.0f;
+		joy->cal[i].deadzone = 0.08f;
+		joy->cal[i].sign = 1;
+
+		BQ_Init(&joy->lpf[i], 1);
+		BQ_Configure(&joy->lpf[i], 0, BQ_LOWPASS, JOY_BLOCK_HZ, JOY_LPF_HZ, 0.7071f);
+		BQ_Reset(&joy->lpf[i], joy->cal[i].centre);
+
+		joy->raw[i] = joy->cal[i].centre;
+		joy->axis[i] = 0.0f;
+	}
+	joy->stamp = 0;
+	joy->blocks = 0;
+}
+
+void JOY_ProcessBlock(joystick_t* joy, const uint16_t* samples, uint32_t tick)
+{
+	uint32_t sum[JOY_CHANNELS] = {0};
+
+	for(int n = 0; n < JOY_OVERSAMPLE; ++n)
+		for(int i = 0; i < JOY_CHANNELS; ++i)
+			sum[i] += samples[n * JOY_CHANNELS + i];
+
+	for(int i = 0; i < JOY_CHANNELS; ++i)
+	{
+		joy->raw[i] = BQ_Step(&joy->lpf[i], (float)sum[i] / JOY_OVERSAMPLE);
+		joy->axis[i] = JOY_Map(&joy->cal[i], joy->raw[i]);
+	}
+
+	joy->stamp = tick;
+	joy->blocks++;
+}
+
+float JOY_Map(const joystickAxisCal* cal, float raw)
+{
+	float offset = raw - cal->centre;
+	float span = offset >= 0.0f ? cal->span_pos : cal->span_neg;
+	if(span <= 0.0f)
+		return 0.0f;
+
+	float x = offset / span;
+	float mag = x >= 0.0f ? x : -x;
+	if(mag <= cal->deadzone)
+		return 0.0f;
+
+	//Rescale so the output starts from 0 at the deadzone edge instead of jumping
+	mag = (mag - cal->deadzone) / (1.0f - cal->deadzone);
+	if(mag > 1.0f)
+		mag = 1.0f;
+
+	return (x >= 0.0f ? mag : -mag) * cal->sign;
+}
+
+uint8_t JOY_Alive(const joystick_t* joy, uint32_t tick)
+{
+	return joy->blocks > 0 && tick - joy->stamp <= JOY_TIMEOUT;
+}
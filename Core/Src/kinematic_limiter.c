@@ -0,0 +1,154 @@
+/*
+ * kinematic_limiter.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "kinematic_limiter.h"
+#include "mem_sections.h"
+#include <math.h>
+#include <string.h>
+
+//Steps smaller than this on an axis do not constrain the shared profile
+#define KL_MIN_STEP		1e-6f
+
+/**
+ * \brief Limits of the shared profile for a step: every axis and wheel moves by its own part of the
+ * step times the profile, so each limit is divided by that part
+ * \param [in]      kl pointer to limiter
+ * \param [in]      step step from start to target, linear then angular
+ * \param [out]     cfg profile limits, velocity is unused
+ */
+static void profile_limits(const kinematicLimiter_t* kl, const float* step, speedConfig* cfg);
+
+/**
+ * \brief Tighten the shared limits by one axis moving by d
+ * \param [in, out] cfg profile limits
+ * \param [in]      d part of the step on this axis
+ * \param [in]      up acceleration limit in the direction of d
+ * \param [in]      down acceleration limit against the direction of d
+ * \param [in]      jerk jerk limit, 0 for none
+ */
+static void tighten(speedConfig* cfg, float d, float up, float down, float jerk);
+
+void KL_Init(kinematicLimiter_t* kl, const kinematicConfig* cfg)
+{
+	memset(kl, 0, sizeof(*kl));
+	kl->cfg = cfg;
+	kl->vel_scale = 1.0f;
+}
+
+void KL_LimitRequest(kinematicLimiter_t* kl, float* linear, float* angular)
+{
+	const kinematicConfig* cfg = kl->cfg;
+
+	//The faster wheel is |v| + |w|B/2 whichever way the chair turns
+	float fastest = fabsf(*linear) + fabsf(*angular) * cfg->base_width / 2;
+	float scale = fastest > cfg->max_wheel_vel ? cfg->max_wheel_vel / fastest : 1.0f;
+
+	//Axis limits can be asymmetric (reversing is slower), each one only bounds the scale
+	float limit = *linear >= 0 ? cfg->linear->max_vel : -cfg->linear->min_vel;
+	if(fabsf(*linear) * scale > limit)
+		scale = limit / fabsf(*linear);
+	limit = *angular >= 0 ? cfg->angular->max_vel : -cfg->angular->min_vel;
+	if(fabsf(*angular) * scale > limit)
+		scale = limit / fabsf(*angular);
+
+	kl->vel_scale = scale;
+	*linear *= scale;
+	*angular *= scale;
+}
+
+RAMFUNC void KL_Limit(kinematicLimiter_t* kl, float* linear, float* angular, uint32_t tick)
+{
+	float dt = kl->last_t != 0 ? (float)(tick - kl->last_t) / FREQUENCY : 0;
+	kl->last_t = tick;
+
+	//Same rule as the speed limiter, after a stall start again from rest
+	if(dt > CMD_VEL_TIMEOUT){
+		memset(&kl->profile, 0, sizeof(kl->profile));
+		memset(kl->start, 0, sizeof(kl->start));
+		memset(kl->target, 0, sizeof(kl->target));
+		dt = 0;
+	}
+
+	float step[2] = { kl->target[0] - kl->start[0], kl->target[1] - kl->start[1] };
+	float s, ds;
+	SL_StepProfile(&kl->profile, dt, &s, &ds);
+	//A finished profile lands exactly on its target, a stop ends at zero and not a rounding error away
+	if(kl->profile.t >= kl->profile.t1 + kl->profile.t2 + kl->profile.t3)
+	{
+		s = 1.0f;
+		ds = 0.0f;
+	}
+	kl->linear = kl->start[0] + s * step[0];
+	kl->angular = kl->start[1] + s * step[1];
+
+	//Replan from the current output. Its velocity stays continuous, of its acceleration only the part
+	//along the new step is kept, compared in wheel speed units. There is a part across the step only
+	//when the request changes curvature, and it is at most one jerk limited tick worth
+	if(*linear != kl->target[0] || *angular != kl->target[1]){
+		float a_linear = ds * step[0];
+		float a_turn = ds * step[1] * kl->cfg->base_width / 2;
+
+		kl->start[0] = kl->linear;
+		kl->start[1] = kl->angular;
+		kl->target[0] = *linear;
+		kl->target[1] = *angular;
+		step[0] = kl->target[0] - kl->start[0];
+		step[1] = kl->target[1] - kl->start[1];
+
+		float d_turn = step[1] * kl->cfg->base_width / 2;
+		float norm = step[0] * step[0] + d_turn * d_turn;
+		float a0 = norm > 0 ? (a_linear * step[0] + a_turn * d_turn) / norm : 0;
+
+		speedConfig cfg;
+		profile_limits(kl, step, &cfg);
+		//A step too small to constrain anything is taken at once
+		if(isfinite(cfg.max_jerk))
+			SL_PlanProfile(&kl->profile, 0, a0, 1.0f, &cfg);
+		else
+			memset(&kl->profile, 0, sizeof(kl->profile));
+	}
+
+	*linear = kl->linear;
+	*angular = kl->angular;
+}
+
+static void profile_limits(const kinematicLimiter_t* kl, const float* step, speedConfig* cfg)
+{
+	const kinematicConfig* kc = kl->cfg;
+	float d_turn = step[1] * kc->base_width / 2;
+
+	cfg->min_vel = -INFINITY;
+	cfg->max_vel = INFINITY;
+	cfg->max_acc = INFINITY;
+	cfg->min_acc = -INFINITY;
+	cfg->max_jerk = INFINITY;
+	cfg->min_jerk = -INFINITY;
+
+	tighten(cfg, step[0], step[0] > 0 ? kc->linear->max_acc : -kc->linear->min_acc,
+			step[0] > 0 ? -kc->linear->min_acc : kc->linear->max_acc,
+			fminf(kc->linear->max_jerk, -kc->linear->min_jerk));
+	tighten(cfg, step[1], step[1] > 0 ? kc->angular->max_acc : -kc->angular->min_acc,
+			step[1] > 0 ? -kc->angular->min_acc : kc->angular->max_acc,
+			fminf(kc->angular->max_jerk, -kc->angular->min_jerk));
+	tighten(cfg, step[0] - d_turn, kc->max_wheel_acc, kc->max_wheel_acc, 0);
+	tighten(cfg, step[0] + d_turn, kc->max_wheel_acc, kc->max_wheel_acc, 0);
+}
+
+static void tighten(speedConfig* cfg, float d, float up, float down, float jerk)
+{
+	float mag = fabsf(d);
+	if(mag < KL_MIN_STEP)
+		return;
+
+	cfg->max_acc = fminf(cfg->max_acc, up / mag);
+	cfg->min_acc = fmaxf(cfg->min_acc, -down / mag);
+	if(jerk > 0)
+	{
+		cfg->max_jerk = fminf(cfg->max_jerk, jerk / mag);
+		cfg->min_jerk = -cfg->max_jerk;
+	}
+}
@@ -0,0 +1,101 @@
+/*
+ * odometry.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include <odometry.h>
+#include <encoder.h>
+#include <mem_sections.h>
+#include <math.h>
+#include <string.h>
+
+CCMRAM_BSS odometry_t odometry;
+
+//Count difference between two encoder reads, offset for wrap around
+static int16_t wrapDiff(uint16_t curr, uint16_t prev);
+
+static float wrapAngle(float angle);
+
+void ODOM_Init(odometry_t* odom)
+{
+	memset(odom, 0, sizeof(*odom));
+}
+
+void ODOM_Update(odometry_t* odom, uint16_t* encoder_vals, float gyro_z)
+{
+	uint32_t now = HAL_GetTick();
+
+	//First call only latches the encoder positions
+	if(!odom->initialised)
+	{
+		odom->last_enc[LEFT_INDEX] = encoder_vals[LEFT_INDEX];
+		odom->last_enc[RIGHT_INDEX] = encoder_vals[RIGHT_INDEX];
+		odom->pose.stamp = now;
+		odom->published = odom->pose;
+		odom->initialised = 1;
+		return;
+	}
+
+	float dt = (float)(now - odom->pose.stamp) / FREQUENCY;
+	if(dt <= 0)
+		return;
+
+	//Left encoder counts down when driving forward, same convention as calcVelFromEncoder
+	int16_t d_left = -wrapDiff(encoder_vals[LEFT_INDEX], odom->last_enc[LEFT_INDEX]);
+	int16_t d_right = wrapDiff(encoder_vals[RIGHT_INDEX], odom->last_enc[RIGHT_INDEX]);
+	odom->last_enc[LEFT_INDEX] = encoder_vals[LEFT_INDEX];
+	odom->last_enc[RIGHT_INDEX] = encoder_vals[RIGHT_INDEX];
+
+	odom->pose.ticks[LEFT_INDEX] += d_left;
+	odom->pose.ticks[RIGHT_INDEX] += d_right;
+
+	float ds_left = d_left * (float)ODOM_M_PER_TICK;
+	float ds_right = d_right * (float)ODOM_M_PER_TICK;
+	float ds = (ds_left + ds_right) * 0.5f;
+	float dtheta = (ds_right - ds_left) / (float)BASE_WIDTH;
+
+#if ODOM_USE_GYRO
+	//Gyro gives the heading, the encoder yaw rate slowly corrects the gyro bias.
+	//Wheel slip only leaks into the heading through the bias, at ODOM_BIAS_GAIN
+	float w_gyro = ODOM_GYRO_Z_SIGN * gyro_z;
+	float w_enc = dtheta / dt;
+	odom->gyro_bias += ODOM_BIAS_GAIN * dt * ((w_gyro - odom->gyro_bias) - w_enc);
+	dtheta = (w_gyro - odom->gyro_bias) * dt;
+#endif
+
+	//Midpoint integration of the arc
+	float theta_mid = odom->pose.theta + dtheta * 0.5f;
+	odom->pose.x += ds * cosf(theta_mid);
+	odom->pose.y += ds * sinf(theta_mid);
+	odom->pose.theta = wrapAngle(odom->pose.theta + dtheta);
+	odom->pose.v = ds / dt;
+	odom->pose.w = dtheta / dt;
+	odom->pose.stamp = now;
+
+	//Readers run in interrupt context, keep the copy consistent
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	odom->published = odom->pose;
+	__set_PRIMASK(primask);
+}
+
+static int16_t wrapDiff(uint16_t curr, uint16_t prev)
+{
+	int16_t diff = curr - prev;
+	if(diff < -ENCODER_MAX / 2)
+		diff += ENCODER_MAX;
+	else if(diff > ENCODER_MAX / 2)
+		diff -= ENCODER_MAX;
+	return diff;
+}
+
+static float wrapAngle(float angle)
+{
+	if(angle > (float)M_PI)
+		angle -= 2.0f * (float)M_PI;
+	else if(angle < -(float)M_PI)
+		angle += 2.0f * (float)M_PI;
+	return angle;
+}
@@ -0,0 +1,165 @@
+/*
+ * param_store.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "param_store.h"
+#include <string.h>
+
+extern CRC_HandleTypeDef hcrc;
+
+//Each record is a header word (id in the low half, size in the high half), a CRC word
+//and the payload padded to whole words. The header is programmed last, so a record
+//cut short by a reset reads as erased and is skipped
+#define HEADER_ERASED			0xFFFFFFFFU
+#define WORDS(size)				(((uint32_t)(size) + 3) / 4)
+
+static uint32_t recordCrc(uint32_t header, const uint32_t* payload, uint16_t size);
+static uint32_t findEnd(void);
+static uint8_t program(uint32_t addr, uint16_t id, const void* data, uint16_t size);
+static uint8_t compact(uint16_t skip_id);
+
+uint8_t PARAM_Load(uint16_t id, void* data, uint16_t size)
+{
+	const uint32_t* found = NULL;
+	uint32_t addr = PARAM_START_ADDR;
+
+	//Newer copies are further along the log
+	while(addr + 8 <= PARAM_END_ADDR)
+	{
+		uint32_t header = *(const uint32_t*)addr;
+		if(header == HEADER_ERASED)
+			break;
+
+		uint16_t rec_size = header >> 16;
+		const uint32_t* payload = (const uint32_t*)(addr + 8);
+		if((header & 0xFFFF) == id && rec_size == size
+				&& recordCrc(header, payload, rec_size) == *(const uint32_t*)(addr + 4))
+			found = payload;
+
+		addr += 8 + WORDS(rec_size) * 4;
+	}
+
+	if(found == NULL)
+		return 0;
+
+	memcpy(data, found, size);
+	return 1;
+}
+
+uint8_t PARAM_Save(uint16_t id, const void* data, uint16_t size)
+{
+	if(size == 0 || size > PARAM_MAX_SIZE || id == 0xFFFF)
+		return 0;
+
+	uint32_t addr = findEnd();
+	if(addr + 8 + WORDS(size) * 4 <= PARAM_END_ADDR && program(addr, id, data, size))
+		return 1;
+
+	//Sector is full or the tail holds a partial record, start over keeping the other blocks
+	if(!compact(id))
+		return 0;
+
+	addr = findEnd();
+	return program(addr, id, data, size);
+}
+
+static uint32_t recordCrc(uint32_t header, const uint32_t* payload, uint16_t size)
+{
+	uint32_t buf[1 + WORDS(PARAM_MAX_SIZE)] = {0};
+	buf[0] = header;
+	memcpy(&buf[1], payload, size);
+	return HAL_CRC_Calculate(&hcrc, buf, 1 + WORDS(size));
+}
+
+static uint32_t findEnd(void)
+{
+	uint32_t addr = PARAM_START_ADDR;
+	while(addr + 8 <= PARAM_END_ADDR && *(const uint32_t*)addr != HEADER_ERASED)
+		addr += 8 + WORDS(*(const uint32_t*)addr >> 16) * 4;
+	return addr;
+}
+
+static uint8_t program(uint32_t addr, uint16_t id, const void* data, uint16_t size)
+{
+	uint32_t payload[WORDS(PARAM_MAX_SIZE)] = {0};
+	memcpy(payload, data, size);
+
+	uint32_t header = (uint32_t)size << 16 | id;
+	uint32_t crc = recordCrc(header, payload, size);
+	uint8_t ok = 1;
+
+	HAL_FLASH_Unlock();
+	for(uint32_t i = 0; i < WORDS(size) && ok; ++i)
+		ok = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, addr + 8 + i * 4, payload[i]) == HAL_OK;
+	if(ok)
+		ok = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, addr + 4, crc) == HAL_OK;
+	if(ok)
+		ok = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, addr, header) == HAL_OK;
+	HAL_FLASH_Lock();
+
+	return ok;
+}
+
+static uint8_t compact(uint16_t skip_id)
+{
+	//Newest valid copy of every other id, gathered before the erase
+	static uint8_t live[PARAM_MAX_LIVE];
+	uint16_t ids[16];
+	uint16_t sizes[16];
+	uint16_t count = 0, used = 0;
+
+	uint32_t addr = PARAM_START_ADDR;
+	while(addr + 8 <= PARAM_END_ADDR && *(const uint32_t*)addr != HEADER_ERASED)
+	{
+		uint32_t header = *(const uint32_t*)addr;
+		uint16_t id = header & 0xFFFF;
+		uint16_t size = header >> 16;
+		addr += 8 + WORDS(size) * 4;
+
+		if(id == skip_id)
+			continue;
+
+		uint8_t seen = 0;
+		for(uint16_t i = 0; i < count; ++i)
+			seen |= ids[i] == id;
+		if(seen || count >= sizeof(ids) / sizeof(ids[0]) || size > PARAM_MAX_SIZE
+				|| used + WORDS(size) * 4 > PARAM_MAX_LIVE)
+			continue;
+
+		if(PARAM_Load(id, &live[used], size))
+		{
+			ids[count] = id;
+			sizes[count++] = size;
+			used += WORDS(size) * 4;
+		}
+	}
+
+	FLASH_EraseInitTypeDef erase = {
+			.TypeErase = FLASH_TYPEERASE_SECTORS,
+			.Sector = PARAM_SECTOR,
+			.NbSectors = 1,
+			.VoltageRange = FLASH_VOLTAGE_RANGE_3
+	};
+	uint32_t sector_error;
+
+	HAL_FLASH_Unlock();
+	HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&erase, &sector_error);
+	HAL_FLASH_Lock();
+	if(status != HAL_OK)
+		return 0;
+
+	addr = PARAM_START_ADDR;
+	used = 0;
+	for(uint16_t i = 0; i < count; ++i)
+	{
+		if(!program(addr, ids[i], &live[used], sizes[i]))
+			return 0;
+		addr += 8 + WORDS(sizes[i]) * 4;
+		used += WORDS(sizes[i]) * 4;
+	}
+
+	return 1;
+}
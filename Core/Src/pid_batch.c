@@ -0,0 +1,162 @@
+/*
+ * pid_batch.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "pid_batch.h"
+#include "mem_sections.h"
+#include <math.h>
+#include <string.h>
+
+void PIDB_Init(pidBatch_t* batch)
+{
+	memset(batch, 0, sizeof(*batch));
+}
+
+void PIDB_Load(pidBatch_t* batch, uint32_t idx, const PID_Struct* pid)
+{
+	if(idx >= PIDB_MAX)
+		return;
+	if(idx >= batch->n)
+		batch->n = idx + 1;
+
+	//Reversed controllers have all gains negated by checkSigns already
+	batch->p[idx] = pid->P;
+	batch->i[idx] = pid->I;
+	batch->d[idx] = pid->D;
+	batch->f[idx] = pid->F;
+
+	//The scalar library treats zero as disabled, infinity gives the same result without a branch
+	batch->i_max[idx] = pid->maxIOutput != 0 ? pid->maxIOutput : INFINITY;
+	if(pid->minOutput != pid->maxOutput)
+	{
+		batch->out_min[idx] = pid->minOutput;
+		batch->out_max[idx] = pid->maxOutput;
+	}
+	else
+	{
+		batch->out_min[idx] = -INFINITY;
+		batch->out_max[idx] = INFINITY;
+	}
+	if(pid->outputRampRate != 0 && pid->outputDescentRate != 0)
+	{
+		batch->ramp[idx] = pid->outputRampRate;
+		batch->descent[idx] = -pid->outputDescentRate;
+	}
+	else
+	{
+		batch->ramp[idx] = INFINITY;
+		batch->descent[idx] = INFINITY;
+	}
+	PIDB_Reset(batch, idx);
+}
+
+void PIDB_Reset(pidBatch_t* batch, uint32_t idx)
+{
+	batch->error_sum[idx] = 0;
+	batch->prev_error[idx] = 0;
+	batch->last_output[idx] = 0;
+	batch->first_run[idx] = 1;
+}
+
+RAMFUNC void PIDB_Step(pidBatch_t* batch, const float* actual, const float* setpoint, float dt,
+		float* output)
+{
+	const float inv_dt = 1.0f / dt;
+	float sp[PIDB_MAX] = { 0 }, err[PIDB_MAX] = { 0 };
+	uint8_t priming = 0;
+
+	//Unused slots have zero gains and limits, padding them keeps the main loop a fixed length
+	for(uint32_t k = 0; k < batch->n; ++k)
+	{
+		sp[k] = setpoint[k];
+		err[k] = setpoint[k] - actual[k];
+		priming |= batch->first_run[k];
+	}
+
+	//Selects instead of branches, conditional moves on the M4 and packed min/max on a host build
+	for(uint32_t k = 0; k < PIDB_MAX; ++k)
+	{
+		float error = err[k];
+		float old_sum = batch->error_sum[k];
+		float sum = old_sum + error * dt;
+
+		float i_raw = batch->i[k] * sum;
+		float i_out = fminf(fmaxf(i_raw, -batch->i_max[k]), batch->i_max[k]);
+		uint32_t limited = i_out != i_raw;
+
+		float out = batch->f[k] * sp[k] + batch->p[k] * error + i_out
+				+ batch->d[k] * (error - batch->prev_error[k]) * inv_dt;
+
+		//Ramp limits swap sides with the sign of the last output, as in PID_getOutput
+		float last = batch->last_output[k];
+		float up = last > 0 ? batch->ramp[k] : batch->descent[k];
+		float down = last > 0 ? batch->descent[k] : batch->ramp[k];
+		float ramped = fminf(fmaxf(out, last - down * dt), last + up * dt);
+		limited |= ramped != out;
+
+		float clamped = fminf(fmaxf(ramped, batch->out_min[k]), batch->out_max[k]);
+		limited |= clamped != ramped;
+
+		//Freeze the integrator whenever any limit was hit
+		batch->error_sum[k] = limited ? old_sum : sum;
+		batch->prev_error[k] = error;
+		batch->last_output[k] = clamped;
+	}
+
+	//Like PID_getOutput the first step only records the error and outputs nothing. Rare, so it
+	//is undone here rather than tested in the loop above
+	if(priming)
+	{
+		for(uint32_t k = 0; k < batch->n; ++k)
+		{
+			if(batch->first_run[k])
+			{
+				batch->error_sum[k] = 0;
+				batch->last_output[k] = 0;
+				batch->first_run[k] = 0;
+			}
+		}
+	}
+
+	for(uint32_t k = 0; k < batch->n; ++k)
+		output[k] = batch->last_output[k];
+}
+
+float PIDB_Benchmark(const pidBatch_t* batch, const PID_Struct* pids, uint32_t iterations,
+		float* scalar_cycles)
+{
+	pidBatch_t bench = *batch;
+	PID_Struct scalar[PIDB_MAX];
+	float actual[PIDB_MAX] = { 0 }, setpoint[PIDB_MAX], output[PIDB_MAX];
+	float dt = 1.0f / pids[0].frequency;
+
+	for(uint32_t k = 0; k < bench.n; ++k)
+	{
+		scalar[k] = pids[k];
+		setpoint[k] = 0.5f;
+	}
+
+	uint32_t start = DWT->CYCCNT;
+	for(uint32_t n = 0; n < iterations; ++n)
+	{
+		for(uint32_t k = 0; k < bench.n; ++k)
+		{
+			//Pretend a period has passed so every call runs the full calculation
+			scalar[k].prev_time = HAL_GetTick() - (uint32_t)(FREQUENCY * dt);
+			output[k] = PID_getOutput(&scalar[k], actual[k], setpoint[k]);
+		}
+		actual[0] = output[0] * 1e-3f;
+	}
+	*scalar_cycles = (float)(DWT->CYCCNT - start) / iterations;
+
+	start = DWT->CYCCNT;
+	for(uint32_t n = 0; n < iterations; ++n)
+	{
+		PIDB_Step(&bench, actual, setpoint, dt, output);
+		actual[0] = output[0] * 1e-3f;
+	}
+	return (float)(DWT->CYCCNT - start) / iterations;
+}
@@ -0,0 +1,238 @@
+/*
+ * ros_link.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "ros_link.h"
+#include "cmd_buffer.h"
+#include "clock_sync.h"
+#include "timebase.h"
+#include "trace.h"
+#include "main.h"
+#include <string.h>
+
+rosLink_t ros_link;
+
+/**
+ * \brief Byte at a free running index of the receive ring
+ */
+static inline uint8_t peek(const rosLink_t* link, uint32_t idx)
+{
+	return link->rx[idx & (LINK_RX_SIZE - 1)];
+}
+
+static inline uint16_t peek16(const rosLink_t* link, uint32_t idx)
+{
+	return peek(link, idx) | (uint16_t)peek(link, idx + 1) << 8;
+}
+
+static inline uint32_t peek32(const rosLink_t* link, uint32_t idx)
+{
+	return peek16(link, idx) | (uint32_t)peek16(link, idx + 2) << 16;
+}
+
+static inline uint64_t peek64(const rosLink_t* link, uint32_t idx)
+{
+	return peek32(link, idx) | (uint64_t)peek32(link, idx + 4) << 32;
+}
+
+static uint16_t crc16(const rosLink_t* link, uint32_t idx, uint32_t len)
+{
+	uint16_t crc = 0xFFFF;
+	while(len--)
+	{
+		crc ^= (uint16_t)peek(link, idx++) << 8;
+		for(int b = 0; b < 8; ++b)
+			crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+/**
+ * \brief Time the first byte of a frame of len bytes ending at end went on the line. Referencing the
+ * start keeps the exchange symmetric with the telemetry stamp, which marks the end of its frame.
+ * The idle line interrupt fires one character after the last stop bit, when it belongs to this frame
+ * it is far more precise than the poll time
+ */
+static uint32_t arrival(const rosLink_t* link, uint32_t end, uint32_t len, uint32_t now)
+{
+	uint32_t stamp = link->idle_stamp;
+	uint32_t pos = link->idle_pos;
+	if(pos == (end & (LINK_RX_SIZE - 1)) && now - stamp < LINK_IDLE_MAX_AGE)
+		now = stamp - link->char_time;
+	return now - len * link->char_time;
+}
+
+static void parse_ping(rosLink_t* link, uint32_t len, uint64_t now)
+{
+	uint32_t idx = link->rd + LINK_BATCH_HEADER;
+	uint32_t seq = peek32(link, link->rd + 4);
+	uint64_t t1 = peek64(link, idx);
+	uint32_t prev_seq = peek32(link, idx + 8);
+	uint64_t t4 = peek64(link, idx + 12);
+
+	SYNC_Ping(&clock_sync, seq, t1, prev_seq, t4, arrival(link, link->rd + len, len, (uint32_t)now), now);
+	link->pings++;
+}
+
+/**
+ * \brief Try to parse a batch or ping frame at rd
+ * \return Frame length if parsed, 0 if more bytes are needed, -1 if it is not a valid frame
+ */
+static int32_t parse_batch(rosLink_t* link, uint32_t avail, uint64_t now)
+{
+	if(avail < LINK_BATCH_HEADER)
+		return 0;
+
+	uint8_t type = peek(link, link->rd + 2);
+	uint8_t count = peek(link, link->rd + 3);
+	uint8_t absolute = type & LINK_BATCH_ABSOLUTE;
+	type &= ~LINK_BATCH_ABSOLUTE;
+
+	uint32_t len;
+	if(type == LINK_PING && count == 0 && !absolute)
+		len = LINK_BATCH_HEADER + LINK_PING_PAYLOAD + 2;
+	else if(type <= LINK_BATCH_CHASSIS && count != 0 && count <= LINK_BATCH_MAX)
+		len = LINK_BATCH_HEADER + count * LINK_BATCH_POINT + 2;
+	else
+		return -1;
+
+	if(avail < len)
+		return 0;
+
+	if(crc16(link, link->rd + 2, len - 4) != peek16(link, link->rd + len - 2))
+	{
+		link->crc_errors++;
+		TRACE_Event(TRACE_EV_LINK_CRC, link->crc_errors, 0);
+		return -1;
+	}
+
+	if(type == LINK_PING)
+	{
+		parse_ping(link, len, now);
+		return len;
+	}
+
+	uint32_t start = peek32(link, link->rd + 4);
+	if(absolute)
+	{
+		//Without a clock estimate there is no way to place the points, drop the frame whole
+		if(clock_sync.exchanges == 0)
+		{
+			link->unsynced++;
+			return len;
+		}
+		//Extend the host stamp around the current host time, it may lie either side of it
+		uint64_t host_now = SYNC_ToHost(&clock_sync, now);
+		uint64_t host_start = host_now + (int32_t)(start - (uint32_t)host_now);
+		start = (uint32_t)SYNC_ToMcu(&clock_sync, host_start);
+	}
+	else
+		start += (uint32_t)now;
+
+	cmdPoint points[LINK_BATCH_MAX];
+	for(uint32_t k = 0; k < count; ++k)
+	{
+		uint32_t idx = link->rd + LINK_BATCH_HEADER + k * LINK_BATCH_POINT;
+		float a = (int16_t)peek16(link, idx + 2) / 1000.0f;
+		float b = (int16_t)peek16(link, idx + 4) / 1000.0f;
+
+		points[k].stamp = start + peek16(link, idx) * 1000U;
+		if(type == LINK_BATCH_CHASSIS)
+		{
+			points[k].left = a - b * BASE_WIDTH / 2;
+			points[k].right = a + b * BASE_WIDTH / 2;
+		}
+		else
+		{
+			points[k].left = a;
+			points[k].right = b;
+		}
+	}
+	CMD_PushSchedule(&cmd_buffer, points, count);
+	link->batches++;
+	return len;
+}
+
+void LINK_Init(rosLink_t* link, UART_HandleTypeDef* huart)
+{
+	memset(link, 0, sizeof(*link));
+	link->huart = huart;
+	//Start bit, 8 data bits and a stop bit, rounded up
+	link->char_time = (10000000U + huart->Init.BaudRate - 1) / huart->Init.BaudRate;
+	link->idle_pos = UINT32_MAX;
+	HAL_UART_Receive_DMA(huart, link->rx, LINK_RX_SIZE);
+	__HAL_UART_ENABLE_IT(huart, UART_IT_IDLE);
+}
+
+void LINK_IdleCallback(rosLink_t* link)
+{
+	if(link->huart == NULL || !__HAL_UART_GET_FLAG(link->huart, UART_FLAG_IDLE))
+		return;
+	__HAL_UART_CLEAR_IDLEFLAG(link->huart);
+	link->idle_pos = (LINK_RX_SIZE - __HAL_DMA_GET_COUNTER(link->huart->hdmarx)) & (LINK_RX_SIZE - 1);
+	link->idle_stamp = TB_Micros();
+}
+
+uint32_t LINK_Poll(rosLink_t* link, uint64_t now, uint32_t tick)
+{
+	//HAL aborts DMA reception on overrun and framing errors, start over with an empty ring
+	if(link->huart->RxState == HAL_UART_STATE_READY)
+	{
+		link->rd = link->wr = 0;
+		link->restarts++;
+		TRACE_Event(TRACE_EV_LINK_RESTART, link->restarts, 0);
+		HAL_UART_Receive_DMA(link->huart, link->rx, LINK_RX_SIZE);
+		__HAL_UART_ENABLE_IT(link->huart, UART_IT_IDLE);
+		return 0;
+	}
+
+	//Free running write index from the DMA counter, which counts down and reloads on wrap
+	uint32_t pos = LINK_RX_SIZE - __HAL_DMA_GET_COUNTER(link->huart->hdmarx);
+	link->wr += (pos - link->wr) & (LINK_RX_SIZE - 1);
+
+	//Data overwritten before it was read is lost, skip to the oldest byte still in the ring
+	if(link->wr - link->rd > LINK_RX_SIZE)
+		link->rd = link->wr - LINK_RX_SIZE;
+
+	uint32_t parsed = 0;
+	while(link->wr != link->rd)
+	{
+		uint32_t avail = link->wr - link->rd;
+
+		if(avail >= 2 && peek16(link, link->rd) == LINK_BATCH_MAGIC)
+		{
+			int32_t len = parse_batch(link, avail, now);
+			if(len == 0)
+				break;
+			if(len > 0)
+			{
+				link->rd += len;
+				link->last_frame = tick;
+				parsed++;
+				continue;
+			}
+		}
+		else if(avail < SIZE_DATA_FROM_ROS)
+			break;
+		else if(peek16(link, link->rd + SIZE_DATA_FROM_ROS - 2) == LINK_LEGACY_END)
+		{
+			link->legacy[LEFT_INDEX] = (int16_t)peek16(link, link->rd);
+			link->legacy[RIGHT_INDEX] = (int16_t)peek16(link, link->rd + 2);
+			CMD_PushArrival(&cmd_buffer, (uint32_t)now, link->legacy[LEFT_INDEX] / 1000.0f,
+					link->legacy[RIGHT_INDEX] / 1000.0f);
+			link->rd += SIZE_DATA_FROM_ROS;
+			link->last_frame = tick;
+			link->frames++;
+			parsed++;
+			continue;
+		}
+
+		//Not at the start of a frame, e.g. connected midway through one
+		link->rd++;
+		link->resyncs++;
+	}
+	return parsed;
+}
@@ -0,0 +1,94 @@
+/*
+ * scheduler.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "scheduler.h"
+#include "timebase.h"
+#include "trace.h"
+#include <stddef.h>
+#include <string.h>
+
+//Time comparisons that hold across the 32 bit timebase wrap
+static inline uint8_t reached(uint32_t now, uint32_t t)
+{
+	return (int32_t)(now - t) >= 0;
+}
+
+void SCHED_Init(scheduler_t* sched, const schedTaskConfig* table, uint8_t count)
+{
+	memset(sched, 0, sizeof(scheduler_t));
+	sched->count = count > SCHED_MAX_TASKS ? SCHED_MAX_TASKS : count;
+	for(uint8_t i = 0; i < sched->count; i++)
+		sched->tasks[i].config = &table[i];
+}
+
+void SCHED_Start(scheduler_t* sched)
+{
+	sched->start = TB_Micros();
+	sched->busy_us = 0;
+	for(uint8_t i = 0; i < sched->count; i++)
+	{
+		schedTask* task = &sched->tasks[i];
+		memset(&task->stats, 0, sizeof(schedStats));
+		task->release = sched->start + task->config->phase_us;
+	}
+}
+
+const schedTask* SCHED_Run(scheduler_t* sched)
+{
+	uint32_t now = TB_Micros();
+
+	//Earliest deadline first among the released tasks, table order breaks ties
+	schedTask* next = NULL;
+	uint32_t next_deadline = 0;
+	for(uint8_t i = 0; i < sched->count; i++)
+	{
+		schedTask* task = &sched->tasks[i];
+		if(!reached(now, task->release))
+			continue;
+		uint32_t deadline = task->release + task->config->deadline_us;
+		if(next == NULL || (int32_t)(deadline - next_deadline) < 0)
+		{
+			next = task;
+			next_deadline = deadline;
+		}
+	}
+	if(next == NULL)
+		return NULL;
+
+	const schedTaskConfig* config = next->config;
+	schedStats* stats = &next->stats;
+	uint32_t release = next->release;
+	uint32_t start = TB_Micros();
+	config->run();
+	uint32_t end = TB_Micros();
+
+	stats->runs++;
+	stats->last_us = end - start;
+	stats->total_us += stats->last_us;
+	if(stats->last_us > stats->max_us)
+		stats->max_us = stats->last_us;
+	stats->last_late_us = start - release;
+	if(stats->last_late_us > stats->max_late_us)
+		stats->max_late_us = stats->last_late_us;
+	sched->busy_us += stats->last_us;
+	if(!reached(release + config->deadline_us, end))
+	{
+		stats->misses++;
+		TRACE_Event(TRACE_EV_DEADLINE, next - sched->tasks, end - release);
+	}
+
+	//Keep the phase. A task that fell a whole period or more behind drops the releases it missed
+	//instead of running them back to back
+	next->release = release + config->period_us;
+	if(reached(end, next->release + config->period_us))
+	{
+		uint32_t behind = (end - next->release) / config->period_us;
+		stats->skipped += behind;
+		next->release += behind * config->period_us;
+	}
+	return next;
+}
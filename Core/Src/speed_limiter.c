@@ -6,6 +6,7 @@
  */
 
 #include "speed_limiter.h"
+#include "mem_sections.h"
 #define MAX(x,y) (((x) > (y)) ? (x) : (y))
 #define MIN(x,y) (((x) < (y)) ? (x) : (y))
 
@@ -22,40 +23,6 @@
  */
 static float clamp(float x, float min, float max);
 
-/**
- * \brief Limit the velocity
- * \param [in, out] v Velocity [m/s]
- * \param [in]      v_min min allowable velocity [m/s]
- * \param [in]      v_max max allowable velocity [m/s]
- * \return Limiting factor (1.0 if none)
- *
- */
-static float limit_velocity(float* v, float v_min, float v_max);
-
-/**
- * \brief Limit the acceleration
- * \param [in, out] v  Velocity [m/s]
- * \param [in]      v0 Previous velocity [m/s]
- * \param [in]      dt Time step [s]
- * \param [in]      a_min min allowable acceleration [m/s2]
- * \param [in]      a_max max allowable acceleration [m/s2]
- * \return Limiting factor (1.0 if none)
- */
-static float limit_acceleration(float* v, float v0, float dt, float a_min, float a_max);
-
-/**
- * \brief Limit the jerk
- * \param [in, out] v  Velocity [m/s]
- * \param [in]      v0 Previous velocity to v  [m/s]
- * \param [in]      v1 Previous velocity to v0 [m/s]
- * \param [in]      j_min min allowable jerk [m/s3]
- * \param [in]      j_max max allowable jerk [m/s3]
- * \param [in]      dt Time step [s]
- * \return Limiting factor (1.0 if none)
- * \see http://en.wikipedia.org/wiki/Jerk_%28physics%29#Motion_control
- */
-static float limit_jerk(float* v, float v0, float v1, float dt, float j_min, float j_max);
-
 void SL_Init(limiter_t* limiter, speedConfig* speed_config)
 {
 	memset(limiter, 0, sizeof(*limiter));
@@ -63,89 +30,107 @@ void SL_Init(limiter_t* limiter, speedConfig* speed_config)
 	//TODO: Test effect of exponential mapping
 }
 
-float SL_Limit(limiter_t* limiter)
+RAMFUNC float SL_Limit(limiter_t* limiter)
 {
-	if(limiter->dt == 0 && limiter->last_t == 0){
-		limiter->last_t = limiter->curr_t;
-		return 1.0;
-	}
+	const speedConfig* cfg = limiter->speed_config;
+	float request = limiter->v;
 
-	limiter->dt = (float)(limiter->curr_t - limiter->last_t)/FREQUENCY;
+	limiter->dt = limiter->last_t != 0 ? (float)(limiter->curr_t - limiter->last_t)/FREQUENCY : 0;
+	limiter->last_t = limiter->curr_t;
 
+	//After a stall start again from rest rather than from stale state
 	if(limiter->dt > CMD_VEL_TIMEOUT){
-		speedConfig dummy = *(limiter->speed_config);
-		SL_Init(limiter, &dummy);
-		return 1.0;
+		memset(&limiter->profile, 0, sizeof(limiter->profile));
+		limiter->target = 0;
+		limiter->a = 0;
+		limiter->x = 0;
+		limiter->dt = 0;
 	}
 
+	float target = request;
 	if (limiter->exponential_mapping == 1){
-		float norm = (limiter->v > 0) ? limiter->speed_config->max_vel : fabs(limiter->speed_config->min_vel);
-		float x = limiter->v / norm;
-		x = x * x * x;
-		limiter->v *= x;
+		float norm = (target > 0) ? cfg->max_vel : fabs(cfg->min_vel);
+		float x = target / norm;
+		target = norm * x * x * x;
 	}
+	target = clamp(target, cfg->min_vel, cfg->max_vel);
 
-	float tmp = limiter->v;
-	float* v = &limiter->v;
-	float v0 = limiter->v0;
-	float v1 = limiter->v1;
-	limit_jerk(v, v0, v1, limiter->dt,limiter->speed_config->min_jerk, limiter->speed_config->max_jerk);
-	limit_acceleration(v, v0, limiter->dt,limiter->speed_config->min_acc, limiter->speed_config->max_acc);
-	limit_velocity(v,limiter->speed_config->min_vel, limiter->speed_config->max_vel);
+	float v, a;
+	SL_StepProfile(&limiter->profile, limiter->dt, &v, &a);
 
-	limiter->last_t = limiter->curr_t;
+	//Replan from where the running profile is now, acceleration stays continuous
+	if(target != limiter->target){
+		SL_PlanProfile(&limiter->profile, v, a, target, cfg);
+		limiter->target = target;
+	}
 
-	limiter->v0 = limiter->v;
-	limiter->v1 = limiter->v0;
-	return tmp != 0.0 ? limiter->v / tmp : 1.0;
+	limiter->x += v * limiter->dt;
+	limiter->a = a;
+	limiter->v = v;
+	return request != 0.0 ? v / request : 1.0;
 }
 
-
-
-static float limit_velocity(float* v, float v_min, float v_max)
+RAMFUNC void SL_PlanProfile(sCurve* c, float v0, float a0, float target, const speedConfig* cfg)
 {
-	const float tmp = *v;
-	*v = clamp(*v, v_min, v_max);
-
-	return tmp != 0.0 ? *v / tmp : 1.0;
+	c->v0 = v0;
+	c->a0 = a0;
+	c->t = 0;
+	c->jerk = MIN(cfg->max_jerk, -cfg->min_jerk);
+
+	//Velocity reached by ramping the acceleration straight to zero decides the direction
+	float v_stop = v0 + a0 * fabsf(a0) / (2 * c->jerk);
+	c->sign = target >= v_stop ? 1.0f : -1.0f;
+
+	//Work on a rising profile, the sign is applied back when it is evaluated
+	float a_max = c->sign > 0 ? cfg->max_acc : -cfg->min_acc;
+	float a = c->sign * a0;
+	float dv = c->sign * (target - v0);
+
+	//Peak acceleration of a profile with no constant acceleration phase
+	float a_peak = sqrtf(MAX(c->jerk * dv + a * a / 2, 0));
+	if(a_peak > a_max)
+		a_peak = a_max;
+
+	c->a_peak = a_peak;
+	c->j1 = a_peak >= a ? c->jerk : -c->jerk;
+	c->t1 = fabsf(a_peak - a) / c->jerk;
+	c->t3 = a_peak / c->jerk;
+
+	float dv1 = (a + a_peak) / 2 * c->t1;
+	float dv3 = a_peak * c->t3 / 2;
+	c->t2 = a_peak > 0 ? MAX((dv - dv1 - dv3) / a_peak, 0) : 0;
 }
 
-static float limit_acceleration(float* v, float v0, float dt, float a_min, float a_max)
+RAMFUNC void SL_StepProfile(sCurve* c, float dt, float* v, float* a)
 {
-	float tmp = *v;
-
-	float dv_min = a_min * dt;
-	float dv_max = a_max * dt;
-
-	float dv = clamp(*v - v0, dv_min, dv_max);
-
-	*v = v0 + dv;
-
-	return tmp != 0.0 ? *v / tmp : 1.0;
-}
-
-static float limit_jerk(float* v, float v0, float v1, float dt, float j_min, float j_max)
-{
-	float tmp = *v;
-
-	float dv  = *v  - v0;
-	float dv0 = v0 - v1;
-
-	float dt2 = 2. * dt * dt;
-
-	float da_min = j_min * dt2;
-	float da_max = j_max * dt2;
-
-	float da = clamp(dv - dv0, da_min, da_max);
-
-	*v = v0 + dv0 + da;
+	c->t += dt;
+	float t = c->t;
+	float a0 = c->sign * c->a0;
+	float dv, acc;
+
+	if(t < c->t1){
+		acc = a0 + c->j1 * t;
+		dv = a0 * t + c->j1 * t * t / 2;
+	}
+	else{
+		dv = (a0 + c->a_peak) / 2 * c->t1;
+		t -= c->t1;
+		if(t < c->t2){
+			acc = c->a_peak;
+			dv += c->a_peak * t;
+		}
+		else{
+			dv += c->a_peak * c->t2;
+			t = MIN(t - c->t2, c->t3);
+			acc = c->a_peak - c->jerk * t;
+			dv += c->a_peak * t - c->jerk * t * t / 2;
+		}
+	}
 
-	return tmp != 0.0 ? *v / tmp : 1.0;
+	*v = c->v0 + c->sign * dv;
+	*a = c->sign * acc;
 }
 
-
-
-
 static float clamp(float x, float min, float max)
 {
   return MIN(MAX(min, x), max);
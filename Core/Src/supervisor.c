@@ -0,0 +1,204 @@
+/*
+ * supervisor.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "supervisor.h"
+#include "trace.h"
+#include "mem_sections.h"
+#include <string.h>
+
+//IWDG key register values
+#define IWDG_KEY_RELOAD			0xAAAA
+#define IWDG_KEY_ACCESS			0x5555
+#define IWDG_KEY_START			0xCCCC
+
+//Prescaler /64, 2ms per count at the nominal LSI. Fixed, so a stall only changes the reload
+#define IWDG_PRESCALER			4
+#define IWDG_MS_PER_COUNT		2
+#define IWDG_MAX_RELOAD			0xFFF
+
+#define RECORD_MAGIC			0x53555052
+
+typedef struct{
+	uint32_t magic;
+	uint32_t cause;
+	uint32_t count;
+}supRecord;
+
+CCMRAM_BSS supervisor_t supervisor;
+
+//Left alone by the startup code, so it keeps its content over a reset but not a power cycle
+static NOINIT supRecord record;
+
+static uint32_t reload_for(uint32_t ms)
+{
+	uint32_t reload = ms / IWDG_MS_PER_COUNT;
+	return reload > IWDG_MAX_RELOAD ? IWDG_MAX_RELOAD : reload;
+}
+
+/**
+ * \brief Change the watchdog reload. The previous update must have gone through, which takes a few
+ * LSI cycles
+ * \return 1 if written
+ */
+static uint8_t set_reload(uint32_t reload)
+{
+	if(IWDG->SR & IWDG_SR_RVU)
+		return 0;
+	IWDG->KR = IWDG_KEY_ACCESS;
+	IWDG->RLR = reload;
+	IWDG->KR = IWDG_KEY_RELOAD;
+	return 1;
+}
+
+static void latch(supervisor_t* sup, supCause cause)
+{
+	if(sup->fault == SUP_CAUSE_NONE)
+	{
+		sup->fault = cause;
+		record.cause = cause;
+		TRACE_Event(TRACE_EV_FAULT, cause, 0);
+	}
+	sup->healthy = 0;
+	SUP_SafeOutputs(sup);
+}
+
+void SUP_Init(supervisor_t* sup, const supOutputs* outputs)
+{
+	memset(sup, 0, sizeof(*sup));
+	sup->outputs = *outputs;
+
+	//Top 7 bits of CSR are the reset flags, cleared so the next boot sees only its own
+	sup->reset_flags = RCC->CSR >> 25;
+	RCC->CSR |= RCC_CSR_RMVF;
+
+	if(record.magic != RECORD_MAGIC || (sup->reset_flags & (RCC_CSR_PORRSTF >> 25)))
+		memset(&record, 0, sizeof(record));
+	sup->last_reset = record.cause;
+	if(sup->last_reset == SUP_CAUSE_NONE && (sup->reset_flags & (RCC_CSR_IWDGRSTF >> 25)))
+		sup->last_reset = SUP_CAUSE_WATCHDOG;
+	if(sup->last_reset != SUP_CAUSE_NONE)
+		record.count++;
+	sup->supervised_resets = record.count;
+
+	record.magic = RECORD_MAGIC;
+	record.cause = SUP_CAUSE_NONE;
+}
+
+void SUP_Start(supervisor_t* sup, uint32_t tick)
+{
+	//Keep the watchdog quiet while the core is halted by the debugger
+	DBGMCU->APB1FZ |= DBGMCU_APB1_FZ_DBG_IWDG_STOP;
+
+	IWDG->KR = IWDG_KEY_START;
+	IWDG->KR = IWDG_KEY_ACCESS;
+	IWDG->PR = IWDG_PRESCALER;
+	IWDG->RLR = reload_for(SUP_IWDG_TIMEOUT_MS);
+	IWDG->KR = IWDG_KEY_RELOAD;
+
+	sup->heartbeat = tick;
+	sup->last_start = 0;
+	sup->armed = 1;
+}
+
+void SUP_TickBegin(supervisor_t* sup, uint32_t now, uint32_t tick)
+{
+	sup->heartbeat = tick;
+	//A stall outside the tick, e.g. a flash write by another task, is planned too
+	if(sup->last_start != 0 && !sup->stall_ms && now - sup->last_start >= 2000)
+		sup->missed++;
+	sup->last_start = now;
+	sup->tick_start = now;
+}
+
+void SUP_TickEnd(supervisor_t* sup, uint32_t now, uint8_t idle)
+{
+	sup->exec_us = now - sup->tick_start;
+
+	if(sup->stall_ms)
+	{
+		//A planned stall is not an overrun, and the next period is not a missed tick. Keep the long
+		//timeout until the reload register takes the short one again
+		if(set_reload(reload_for(SUP_IWDG_TIMEOUT_MS)))
+		{
+			sup->stall_ms = 0;
+			sup->last_start = 0;
+		}
+	}
+	else
+	{
+		if(sup->exec_us > sup->worst_us)
+			sup->worst_us = sup->exec_us;
+
+		if(sup->exec_us > SUP_TICK_BUDGET_US)
+		{
+			sup->overruns++;
+			TRACE_Event(TRACE_EV_OVERRUN, sup->exec_us, sup->consecutive + 1);
+			if(++sup->consecutive >= SUP_OVERRUN_LIMIT)
+				latch(sup, SUP_CAUSE_OVERRUN);
+		}
+		else
+			sup->consecutive = 0;
+	}
+
+	//Only clear a fault with the loop back on time and the command released, so the chair does not
+	//lurch off again by itself
+	if(sup->fault != SUP_CAUSE_NONE)
+	{
+		if(idle && sup->consecutive == 0)
+		{
+			if(++sup->healthy >= SUP_RECOVER_TICKS)
+			{
+				sup->fault = SUP_CAUSE_NONE;
+				record.cause = SUP_CAUSE_NONE;
+				TRACE_Event(TRACE_EV_FAULT_CLEAR, 0, 0);
+			}
+		}
+		else
+			sup->healthy = 0;
+	}
+
+	if(sup->armed)
+		IWDG->KR = IWDG_KEY_RELOAD;
+}
+
+void SUP_Stall(supervisor_t* sup, uint32_t ms)
+{
+	if(!sup->armed)
+		return;
+	//Wait out any reload update still in progress, it only takes a few LSI cycles
+	while(!set_reload(reload_for(ms)))
+		;
+	sup->stall_ms = ms;
+	TRACE_Event(TRACE_EV_STALL, ms, 0);
+}
+
+void SUP_Monitor(supervisor_t* sup, uint32_t tick)
+{
+	if(!sup->armed)
+		return;
+	uint32_t limit = sup->stall_ms ? sup->stall_ms : SUP_HANG_MS;
+	if(tick - sup->heartbeat > limit)
+		latch(sup, SUP_CAUSE_HANG);
+}
+
+void SUP_Panic(supCause cause)
+{
+	SUP_SafeOutputs(&supervisor);
+	TRACE_Event(TRACE_EV_PANIC, cause, 0);
+	supervisor.fault = cause;
+	record.magic = RECORD_MAGIC;
+	record.cause = cause;
+}
+
+void SUP_SafeOutputs(const supervisor_t* sup)
+{
+	for(int i = 0; i < 2; ++i)
+		if(sup->outputs.motor[i] != NULL)
+			*sup->outputs.motor[i] = sup->outputs.motor_neutral;
+	if(sup->outputs.brake != NULL)
+		*sup->outputs.brake = sup->outputs.brake_engaged;
+}
@@ -0,0 +1,175 @@
+/*
+ * sysid.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "sysid.h"
+#include <usb_proxy.h>
+#include <wave_lookup.h>
+#include <math.h>
+#include <string.h>
+
+sysid_t sysid;
+
+static uint16_t sent;
+
+static void startSegment(sysid_t* id);
+static void finishSegment(sysid_t* id);
+
+void SYSID_Start(sysid_t* id, const sysidConfig* cfg)
+{
+	memset(id, 0, sizeof(*id));
+	id->cfg = *cfg;
+	if(id->cfg.num_freqs > SYSID_MAX_FREQS)
+		id->cfg.num_freqs = SYSID_MAX_FREQS;
+	if(id->cfg.num_freqs == 0 || id->cfg.fs <= 0.0f)
+		return;
+
+	//Schroeder phases keep the crest factor of the multisine low, -pi*k*(k+1)/N as a fraction of a turn
+	for(uint16_t k = 0; k < id->cfg.num_freqs; ++k)
+	{
+		id->increment[k] = DDS_Increment(id->cfg.fs, id->cfg.freqs[k]);
+		id->phase0[k] = id->cfg.type == SYSID_MULTISINE ?
+				(uint32_t)(-(int64_t)2147483648LL * k * (k + 1) / id->cfg.num_freqs) : 0;
+	}
+
+	id->settle_samples = (uint32_t)(id->cfg.settle_time * id->cfg.fs);
+	id->active = 1;
+	sent = 0;
+	startSegment(id);
+}
+
+void SYSID_Stop(sysid_t* id)
+{
+	id->active = 0;
+	id->excitation = 0.0f;
+}
+
+float SYSID_Step(sysid_t* id, float u, float y)
+{
+	if(!id->active)
+		return id->cfg.offset;
+
+	uint16_t first = id->cfg.type == SYSID_CHIRP ? id->index : 0;
+	uint16_t last = id->cfg.type == SYSID_CHIRP ? id->index + 1 : id->cfg.num_freqs;
+
+	//u and y belong to the phase that generated the previous excitation
+	if(id->n > id->settle_samples)
+	{
+		float du = u - id->cfg.offset;
+		for(uint16_t k = first; k < last; ++k)
+		{
+			float c = DDS_Lookup(wave_sine_table, id->phase[k] + DDS_QUARTER_TURN);
+			float s = DDS_Lookup(wave_sine_table, id->phase[k]);
+			id->u_re[k] += du * c;
+			id->u_im[k] -= du * s;
+			id->y_re[k] += y * c;
+			id->y_im[k] -= y * s;
+		}
+	}
+
+	if(id->n >= id->settle_samples + id->integrate_samples)
+	{
+		finishSegment(id);
+		if(!id->active)
+			return id->cfg.offset;
+		first = id->index;
+		last = id->index + 1;
+	}
+
+	//Advance the tones and build the next excitation
+	int32_t e = 0;
+	for(uint16_t k = first; k < last; ++k)
+	{
+		id->phase[k] += id->increment[k];
+		e += DDS_Lookup(wave_sine_table, id->phase[k]);
+	}
+
+	if(id->cfg.type == SYSID_MULTISINE)
+		e /= id->cfg.num_freqs;
+
+	id->n++;
+	id->excitation = id->cfg.amplitude * e * (1.0f / 32767.0f);
+	return id->cfg.offset + id->excitation;
+}
+
+void SYSID_Flush(sysid_t* id)
+{
+	uint8_t buf[14];
+
+	//One packet per call, a packet the CDC endpoint refused while busy is sent again on the next call
+	if(sent < id->num_results)
+	{
+		sysidPoint* p = &id->result[sent];
+		buf[0] = SYSID_TAG_POINT;
+		buf[1] = (uint8_t)sent;
+		memcpy(&buf[2], &p->freq, 4);
+		memcpy(&buf[6], &p->gain, 4);
+		memcpy(&buf[10], &p->phase, 4);
+		if(USB_Transmit_Cargo(buf, sizeof(buf)) == USBD_OK)
+			sent++;
+	}
+	else if(id->done)
+	{
+		buf[0] = SYSID_TAG_DONE;
+		buf[1] = (uint8_t)id->num_results;
+		if(USB_Transmit_Cargo(buf, 2) == USBD_OK)
+			id->done = 0;
+	}
+}
+
+static void startSegment(sysid_t* id)
+{
+	uint16_t first = id->cfg.type == SYSID_CHIRP ? id->index : 0;
+	uint16_t last = id->cfg.type == SYSID_CHIRP ? id->index + 1 : id->cfg.num_freqs;
+
+	//Whole periods of the lowest tone in the segment, which are also whole periods of its harmonics
+	float f_low = id->cfg.freqs[first];
+	id->integrate_samples = (uint32_t)(id->cfg.periods * id->cfg.fs / f_low + 0.5f);
+	id->n = 0;
+
+	for(uint16_t k = first; k < last; ++k)
+	{
+		id->phase[k] = id->phase0[k];
+		id->u_re[k] = id->u_im[k] = 0.0f;
+		id->y_re[k] = id->y_im[k] = 0.0f;
+	}
+}
+
+static void finishSegment(sysid_t* id)
+{
+	uint16_t first = id->cfg.type == SYSID_CHIRP ? id->index : 0;
+	uint16_t last = id->cfg.type == SYSID_CHIRP ? id->index + 1 : id->cfg.num_freqs;
+
+	for(uint16_t k = first; k < last; ++k)
+	{
+		//H = Y / U
+		float u_mag2 = id->u_re[k] * id->u_re[k] + id->u_im[k] * id->u_im[k];
+		sysidPoint* p = &id->result[id->num_results++];
+		p->freq = id->cfg.freqs[k];
+		if(u_mag2 > 0.0f)
+		{
+			float h_re = (id->y_re[k] * id->u_re[k] + id->y_im[k] * id->u_im[k]) / u_mag2;
+			float h_im = (id->y_im[k] * id->u_re[k] - id->y_re[k] * id->u_im[k]) / u_mag2;
+			p->gain = sqrtf(h_re * h_re + h_im * h_im);
+			p->phase = atan2f(h_im, h_re);
+		}
+		else
+		{
+			p->gain = 0.0f;
+			p->phase = 0.0f;
+		}
+	}
+
+	if(id->cfg.type == SYSID_CHIRP && ++id->index < id->cfg.num_freqs)
+	{
+		startSegment(id);
+		return;
+	}
+
+	id->active = 0;
+	id->done = 1;
+	id->excitation = 0.0f;
+}
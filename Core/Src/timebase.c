@@ -0,0 +1,34 @@
+/*
+ * timebase.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "timebase.h"
+#include "clock_profile.h"
+
+void TB_Init(void)
+{
+	__HAL_RCC_TIM5_CLK_ENABLE();
+	TIMEBASE_TIM->CR1 = 0;
+	TIMEBASE_TIM->PSC = CLK_TimerPrescaler(TIMEBASE_TIM, 1000000);
+	TIMEBASE_TIM->ARR = 0xFFFFFFFF;
+	TIMEBASE_TIM->CNT = 0;
+
+	//Load the prescaler now instead of at the first overflow
+	TIMEBASE_TIM->EGR = TIM_EGR_UG;
+	TIMEBASE_TIM->CR1 = TIM_CR1_CEN;
+}
+
+uint64_t TB_Micros64(void)
+{
+	static uint32_t last = 0;
+	static uint32_t wraps = 0;
+
+	uint32_t now = TB_Micros();
+	if(now < last)
+		wraps++;
+	last = now;
+	return (uint64_t)wraps << 32 | now;
+}
@@ -0,0 +1,115 @@
+/*
+ * trace.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "trace.h"
+#include "usb_proxy.h"
+#include "supervisor.h"
+#include "mem_sections.h"
+#include <string.h>
+
+#define TRACE_MAGIC				0x54524345
+
+//Left alone by the startup code, the content survives anything but a power cycle
+CCMRAM_NOINIT traceRing_t trace_ring;
+CCMRAM_NOINIT traceRing_t trace_snapshot;
+traceDump_t trace_dump;
+
+void TRACE_Init(uint8_t reset_flags, uint8_t reset_cause)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	trace_ring.enabled = 0;
+	if(trace_ring.magic != TRACE_MAGIC || (reset_flags & (RCC_CSR_PORRSTF >> 25)))
+	{
+		memset(&trace_ring, 0, sizeof(trace_ring));
+		memset(&trace_snapshot, 0, sizeof(trace_snapshot));
+		trace_ring.magic = TRACE_MAGIC;
+	}
+	else if(reset_cause != SUP_CAUSE_NONE)
+	{
+		//Logging starts over right away, keep what led up to the reset
+		memcpy(&trace_snapshot, &trace_ring, sizeof(trace_snapshot));
+		trace_snapshot.reset_cause = reset_cause;
+		trace_snapshot.reset_flags = reset_flags;
+		trace_snapshot.valid = 1;
+	}
+
+	//The cycle counter restarts on reset, the boot record marks the discontinuity
+	trace_ring.boots++;
+	trace_ring.core_clock = SystemCoreClock;
+	trace_ring.enabled = 1;
+	TRACE_Event(TRACE_EV_BOOT, reset_flags | reset_cause << 8, trace_ring.boots);
+}
+
+void TRACE_StartDump(traceDump_t* dump, uint8_t source)
+{
+	if(dump->ring != NULL)
+		return;
+
+	traceRing_t* ring = source == TRACE_SOURCE_SNAPSHOT ? &trace_snapshot : &trace_ring;
+	if(source == TRACE_SOURCE_LIVE)
+		trace_ring.enabled = 0;
+
+	dump->source = source;
+	dump->count = ring->head < TRACE_SIZE ? ring->head : TRACE_SIZE;
+	dump->first = ring->head - dump->count;
+	dump->sent = 0;
+	dump->header_sent = 0;
+	dump->ring = ring;
+}
+
+void TRACE_Flush(traceDump_t* dump)
+{
+	traceRing_t* ring = dump->ring;
+	if(ring == NULL)
+		return;
+
+	//One cargo per call. The CDC endpoint refuses a transfer while the previous one is in flight,
+	//a refused cargo is built again on the next call
+	uint8_t buf[4 + TRACE_RECORDS_PER_CARGO * sizeof(traceRecord)];
+	if(!dump->header_sent)
+	{
+		buf[0] = TRACE_TAG_HEADER;
+		buf[1] = dump->source;
+		buf[2] = ring->reset_cause;
+		buf[3] = ring->reset_flags;
+		memcpy(&buf[4], (const void*)&ring->head, 4);
+		memcpy(&buf[8], &dump->count, 4);
+		memcpy(&buf[12], &ring->core_clock, 4);
+		memcpy(&buf[16], &ring->boots, 4);
+		if(USB_Transmit_Cargo(buf, 20) == USBD_OK)
+			dump->header_sent = 1;
+	}
+	else if(dump->sent < dump->count)
+	{
+		uint32_t n = dump->count - dump->sent;
+		if(n > TRACE_RECORDS_PER_CARGO)
+			n = TRACE_RECORDS_PER_CARGO;
+		buf[0] = TRACE_TAG_RECORDS;
+		buf[1] = dump->source;
+		buf[2] = (uint8_t)(dump->sent & 0xFF);
+		buf[3] = (uint8_t)(dump->sent >> 8);
+		for(uint32_t k = 0; k < n; ++k)
+			memcpy(&buf[4 + k * sizeof(traceRecord)],
+					&ring->rec[(dump->first + dump->sent + k) & (TRACE_SIZE - 1)], sizeof(traceRecord));
+		if(USB_Transmit_Cargo(buf, 4 + n * sizeof(traceRecord)) == USBD_OK)
+			dump->sent += n;
+	}
+	else
+	{
+		buf[0] = TRACE_TAG_END;
+		buf[1] = dump->source;
+		if(USB_Transmit_Cargo(buf, 2) != USBD_OK)
+			return;
+		if(dump->source == TRACE_SOURCE_LIVE)
+			trace_ring.enabled = 1;
+		else
+			trace_snapshot.valid = 0;
+		dump->ring = NULL;
+	}
+}
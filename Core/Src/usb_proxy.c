@@ -6,8 +6,9 @@
  */
 
 #include "usb_proxy.h"
+#include "timebase.h"
 
-#define LOG_DATA_SIZE  22
+#define LOG_DATA_SIZE  26
 USBProxyHandler hUSB;
 CRC_HandleTypeDef hcrc;
 
@@ -15,14 +16,26 @@ void USB_Init(USBD_HandleTypeDef *usb_handler) {
 	hUSB.husbd = usb_handler;
 	hUSB.invalidRxMsgCount = 0;
 	hUSB.ifNewCargo = 0;
+	hUSB.ifNewRxMsg = 0;
 	hUSB.ifNewDataLogPiece2Send = 0;
 	hUSB.index.b32 = 0;
 	hUSB.ifDataLogInitiated = 0;
 	hUSB.ifDataLogStarted = 0;
 }
 
-void USB_Transmit_Cargo(uint8_t *buf, uint8_t size) {
-	uint8_t tx_buf[size + 8];
+uint8_t USB_Transmit_Cargo(uint8_t *buf, uint8_t size) {
+	//The frame is read out of txFrame by the USB interrupt after this returns. Leave it alone while
+	//the previous transfer is still in flight, CDC_Transmit_FS would refuse the new one anyway.
+	//Without USB_Init, or before the host configured the device, there is no class handle yet
+	if (hUSB.husbd == NULL)
+		return USBD_FAIL;
+	USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef*) hUSB.husbd->pClassData;
+	if (hcdc == NULL)
+		return USBD_FAIL;
+	if (hcdc->TxState != 0)
+		return USBD_BUSY;
+
+	uint8_t *tx_buf = hUSB.txFrame;
 	tx_buf[0] = 0xAA;
 	tx_buf[1] = 0xCC;
 	tx_buf[2] = size;
@@ -30,7 +43,7 @@ void USB_Transmit_Cargo(uint8_t *buf, uint8_t size) {
 
 	union int32uint8_t crc;
 	uint32_t buf32bit[size + 1]; //Include the byte number one
-	for (uint8_t i = 0; i <= size; i++) {
+	for (uint16_t i = 0; i <= size; i++) {
 		buf32bit[i] = (uint32_t) tx_buf[i + 2];
 	}
 	crc.b32 = HAL_CRC_Calculate(&hcrc, buf32bit, size + 1);
@@ -43,33 +56,43 @@ void USB_Transmit_Cargo(uint8_t *buf, uint8_t size) {
 //	tx_buf[size + 5] = 0x33;
 //	tx_buf[size + 6] = 0x44;
 	tx_buf[size + 7] = 0x55;
-	CDC_Transmit_FS(tx_buf, sizeof(tx_buf));
+	return CDC_Transmit_FS(tx_buf, size + 8);
 }
 
+//Called from the OTG interrupt. Only takes a copy, the CRC unit is shared with the main loop so the
+//packet is checked in USB_Receive_Cargo. A packet arriving before the last one was checked is dropped
 void USB_ReceiveCpltCallback(void) {
+	if (hUSB.ifNewRxMsg || *hUSB.len > sizeof(hUSB.rxMsgRaw)) {
+		hUSB.invalidRxMsgCount++;
+		return;
+	}
 	memset(hUSB.rxMsgRaw, 0, sizeof(hUSB.rxMsgRaw));
 	memcpy(hUSB.rxMsgRaw, hUSB.buf, *hUSB.len);
-	USB_Receive_Cargo();
+	hUSB.rxMsgRawLen = *hUSB.len;
+	hUSB.ifNewRxMsg = 1;
 }
 
 void USB_Receive_Cargo(void) {
-	if (hUSB.rxMsgRaw[0] == (char) 0xBB && hUSB.rxMsgRaw[1] == (char) 0xCC
-			&& hUSB.rxMsgRaw[*hUSB.len - 1] == (char) 0x88) {
-		if (hUSB.rxMsgRaw[2] == *hUSB.len - 8) {
+	if (!hUSB.ifNewRxMsg)
+		return;
+	uint32_t len = hUSB.rxMsgRawLen;
+	if (len >= 8 && hUSB.rxMsgRaw[0] == (char) 0xBB && hUSB.rxMsgRaw[1] == (char) 0xCC
+			&& hUSB.rxMsgRaw[len - 1] == (char) 0x88) {
+		if (hUSB.rxMsgRaw[2] == len - 8) {
 			uint32_t crcCalculatedResult;
 			union int32uint8_t crcReceive;
 
 			hUSB.rxMessageLen = hUSB.rxMsgRaw[2];
 			uint32_t crcCalculate[hUSB.rxMessageLen + 1];
-			for (uint8_t i = 0; i <= hUSB.rxMessageLen; i++)
+			for (uint16_t i = 0; i <= hUSB.rxMessageLen; i++)
 				crcCalculate[i] = (uint32_t) hUSB.rxMsgRaw[2 + i];
 			crcCalculatedResult = HAL_CRC_Calculate(&hcrc, crcCalculate,
 					hUSB.rxMessageLen + 1);
 
-			crcReceive.b8[0] = hUSB.rxMsgRaw[*hUSB.len - 5];
-			crcReceive.b8[1] = hUSB.rxMsgRaw[*hUSB.len - 4];
-			crcReceive.b8[2] = hUSB.rxMsgRaw[*hUSB.len - 3];
-			crcReceive.b8[3] = hUSB.rxMsgRaw[*hUSB.len - 2];
+			crcReceive.b8[0] = hUSB.rxMsgRaw[len - 5];
+			crcReceive.b8[1] = hUSB.rxMsgRaw[len - 4];
+			crcReceive.b8[2] = hUSB.rxMsgRaw[len - 3];
+			crcReceive.b8[3] = hUSB.rxMsgRaw[len - 2];
 
 			if (crcCalculatedResult == crcReceive.b32) {
 				memcpy(hUSB.rxMessageCfrm, &hUSB.rxMsgRaw[3],
@@ -78,12 +101,12 @@ void USB_Receive_Cargo(void) {
 			}
 		} else {
 			hUSB.invalidRxMsgCount++;
-			return;
 		}
 	} else {
 		hUSB.invalidRxMsgCount++;
-		return;
 	}
+	//Hand the raw buffer back to the interrupt
+	hUSB.ifNewRxMsg = 0;
 }
 
 void USB_DataLogInitialization(void) {
@@ -95,8 +118,9 @@ void USB_DataLogInitialization(void) {
 
 void DataLog_CargoTransmit(SendFormat *send_format) {
 	uint8_t i = 0;
-	union uint32uint8_t sysTick;
+	union uint32uint8_t sysTick, micros;
 	sysTick.b32 = HAL_GetTick();
+	micros.b32 = TB_Micros();
 	//Index
 	hUSB.txBuf[i++] = hUSB.index.b8[0];
 	hUSB.txBuf[i++] = hUSB.index.b8[1];
@@ -129,6 +153,11 @@ void DataLog_CargoTransmit(SendFormat *send_format) {
 	//Velocity
 	hUSB.txBuf[i++] = send_format->velocity_2.b8[0];
 	hUSB.txBuf[i++] = send_format->velocity_2.b8[1];
+	//Microsecond time stamp, maps to host time through the clock sync offset reported to ROS
+	hUSB.txBuf[i++] = micros.b8[0];
+	hUSB.txBuf[i++] = micros.b8[1];
+	hUSB.txBuf[i++] = micros.b8[2];
+	hUSB.txBuf[i++] = micros.b8[3];
 //	//Temperature
 //	hUSB.txBuf[i++] = send_format->temperature_1.b8[0];
 //	hUSB.txBuf[i++] = send_format->temperature_1.b8[1];
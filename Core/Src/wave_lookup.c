@@ -7,39 +7,74 @@
 
 #include "wave_lookup.h"
 
-const int sine_table[40] = {0, 		5126, 		10126, 		14876, 		19260, 		23170, 		26509, 		29196, 		31163, 		32364,
-							32767, 	32364, 		31163, 		29196, 		26509, 		23170, 		19260, 		14876, 		10126, 		5126,
-							0, 		-5126, 		-10126,		-14876, 	-19260, 	-23170, 	-26509, 	-29196, 	-31163, 	-32364,
-							-32767, -32364, 	-31163, 	-29196, 	-26509, 	-23170, 	-19260, 	-14876, 	-10126, 	-5126};
-
-
-const int fourier_table[94] = {	0, 			4403, 		8790, 		13145, 		17451, 		21693, 		25855, 		29922,	 	33878, 		37710,
-								41403, 		44945, 		48321, 		51520, 		54531, 		57343, 		59945,	 	62329, 		64486,	 	66409,
-								68092, 		69528,	 	70714, 		71646, 		72322, 		72739,	 	72898,	 	72798, 		72442, 		71831,
-								70970, 		69863, 		68516, 		66935, 		65126, 		63100, 		60864,	 	58429,	 	55805, 		53004,
-								50038, 		46920, 		43664, 		40283, 		36791, 		33205, 		29538, 		25807, 		22028, 		18216,
-								14387, 		10559, 		6747, 		2967, 		-764, 		-4431, 		-8019, 		-11511, 	-14893, 	-18150,
-								-21269, 	-24236, 	-27039, 	-29664, 	-32101, 	-34338, 	-36367, 	-38177, 	-39760, 	-41110,
-								-42219, 	-43083, 	-43695, 	-44054, 	-44157, 	-44001, 	-43587, 	-42915, 	-41986, 	-40803,
-								-39370, 	-37691, 	-35772, 	-33618, 	-31239, 	-28640, 	-25833, 	-22827, 	-19632, 	-16260,
-								-12723, 	-9035, 		-5208, 		-1256};
-
-float sin1(float phase, uint32_t i) {
-  int x1 = (int) phase % SINE_ARR_SIZE;
-  if (x1 < 0) x1 += SINE_ARR_SIZE;
-  int x2 = (x1 + 1) % SINE_ARR_SIZE;
-  float y = (sine_table[x2] - sine_table[x1])
-      * ((float) ((int) (SINE_ARR_SIZE * 0.001 * i * 100) % ((SINE_ARR_SIZE+1)*100)) / 100 - x1)
-      + sine_table[x1];
-  return y;
+void DDS_Init(dds_t* dds, waveType type, float fs, float freq)
+{
+	dds->type = type;
+	dds->phase = 0;
+	dds->increment = DDS_Increment(fs, freq);
+	dds->inc_start = dds->inc_end = dds->increment;
+	dds->sweep = 0;
 }
 
-float fourier(float phase,uint32_t i) {
-  int x1 = (int) phase % FOURIER_ARR_SIZE;
-  if (x1 < 0) x1 += FOURIER_ARR_SIZE;
-  int x2 = (x1 + 1) % FOURIER_ARR_SIZE;
-  float y = (fourier_table[x2] - fourier_table[x1])
-      * ((float) ((int) (FOURIER_ARR_SIZE * 0.001 * i * 100) % ((FOURIER_ARR_SIZE+1)*100)) / 100 - x1)
-      + fourier_table[x1];
-  return y;
+void DDS_InitChirp(dds_t* dds, float fs, float f_start, float f_end, float duration)
+{
+	dds->type = WAVE_CHIRP;
+	dds->phase = 0;
+	dds->inc_start = DDS_Increment(fs, f_start);
+	dds->inc_end = DDS_Increment(fs, f_end);
+	dds->increment = dds->inc_start;
+
+	float samples = duration * fs;
+	dds->sweep = samples >= 1.0f ? (int32_t)(((float)dds->inc_end - (float)dds->inc_start) / samples) : 0;
+}
+
+uint32_t DDS_Increment(float fs, float freq)
+{
+	//Below Nyquist the step fits in 31 bits, compute in double to keep the full 32 bit resolution
+	if(freq <= 0.0f || fs <= 0.0f || freq >= fs / 2)
+		return 0;
+	return (uint32_t)((double)freq / fs * 4294967296.0 + 0.5);
+}
+
+int16_t DDS_Step(dds_t* dds)
+{
+	uint32_t phase = dds->phase;
+	int16_t y;
+
+	switch(dds->type)
+	{
+	case WAVE_SQUARE:
+		y = (phase & 0x80000000U) ? -32767 : 32767;
+		break;
+	case WAVE_TRIANGLE:
+	{
+		//Shifted a quarter turn so it starts at 0 rising, like the sine
+		uint32_t p = phase + DDS_QUARTER_TURN;
+		int32_t ramp = (int32_t)(p >> 16) - 32768;		//-32768..32767 over a turn
+		int32_t t = 32768 - 2 * (ramp < 0 ? -ramp : ramp);
+		y = (int16_t)(t > 32767 ? 32767 : t);
+		break;
+	}
+	case WAVE_MULTISINE:
+		y = DDS_Lookup(wave_multisine_table, phase);
+		break;
+	case WAVE_CHIRP:
+		y = DDS_Lookup(wave_sine_table, phase);
+		//Sweep the step, restart once the end is passed in either direction
+		dds->increment += dds->sweep;
+		if((dds->sweep > 0 && dds->increment >= dds->inc_end)
+				|| (dds->sweep < 0 && dds->increment <= dds->inc_end))
+		{
+			dds->increment = dds->inc_start;
+			dds->phase = 0;
+			return y;
+		}
+		break;
+	default:
+		y = DDS_Lookup(wave_sine_table, phase);
+		break;
+	}
+
+	dds->phase = phase + dds->increment;
+	return y;
 }
@@ -0,0 +1,57 @@
+/*
+ * wave_tables.c
+ *
+ * Generated by script/gen_wave_tables.py, do not edit
+ */
+
+#include "wave_tables.h"
+
+const int16_t wave_sine_table[WAVE_TABLE_SIZE + 1] = {
+		     0,    804,   1608,   2410,   3212,   4011,   4808,   5602,   6393,   7179,   7962,   8739,
+		  9512,  10278,  11039,  11793,  12539,  13279,  14010,  14732,  15446,  16151,  16846,  17530,
+		 18204,  18868,  19519,  20159,  20787,  21403,  22005,  22594,  23170,  23731,  24279,  24811,
+		 25329,  25832,  26319,  26790,  27245,  27683,  28105,  28510,  28898,  29268,  29621,  29956,
+		 30273,  30571,  30852,  31113,  31356,  31580,  31785,  31971,  32137,  32285,  32412,  32521,
+		 32609,  32678,  32728,  32757,  32767,  32757,  32728,  32678,  32609,  32521,  32412,  32285,
+		 32137,  31971,  31785,  31580,  31356,  31113,  30852,  30571,  30273,  29956,  29621,  29268,
+		 28898,  28510,  28105,  27683,  27245,  26790,  26319,  25832,  25329,  24811,  24279,  23731,
+		 23170,  22594,  22005,  21403,  20787,  20159,  19519,  18868,  18204,  17530,  16846,  16151,
+		 15446,  14732,  14010,  13279,  12539,  11793,  11039,  10278,   9512,   8739,   7962,   7179,
+		  6393,   5602,   4808,   4011,   3212,   2410,   1608,    804,      0,   -804,  -1608,  -2410,
+		 -3212,  -4011,  -4808,  -5602,  -6393,  -7179,  -7962,  -8739,  -9512, -10278, -11039, -11793,
+		-12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530, -18204, -18868, -19519, -20159,
+		-20787, -21403, -22005, -22594, -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790,
+		-27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956, -30273, -30571, -30852, -31113,
+		-31356, -31580, -31785, -31971, -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+		-32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285, -32137, -31971, -31785, -31580,
+		-31356, -31113, -30852, -30571, -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683,
+		-27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731, -23170, -22594, -22005, -21403,
+		-20787, -20159, -19519, -18868, -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+		-12539, -11793, -11039, -10278,  -9512,  -8739,  -7962,  -7179,  -6393,  -5602,  -4808,  -4011,
+		 -3212,  -2410,  -1608,   -804,      0,
+};
+
+const int16_t wave_multisine_table[WAVE_TABLE_SIZE + 1] = {
+		     0,  -1542,  -3081,  -4552,  -5896,  -7057,  -7990,  -8661,  -9044,  -9129,  -8917,  -8419,
+		 -7663,  -6682,  -5521,  -4233,  -2872,  -1498,   -170,   1055,   2127,   3000,   3638,   4018,
+		  4123,   3954,   3522,   2849,   1970,    930,   -217,  -1413,  -2593,  -3691,  -4643,  -5387,
+		 -5868,  -6038,  -5859,  -5305,  -4364,  -3034,  -1331,    720,   3078,   5693,   8504,  11443,
+		 14438,  17413,  20293,  23004,  25479,  27658,  29491,  30938,  31973,  32582,  32767,  32541,
+		 31930,  30974,  29722,  28228,  26557,  24774,  22946,  21138,  19411,  17820,  16410,  15218,
+		 14268,  13573,  13134,  12937,  12960,  13168,  13517,  13959,  14438,  14897,  15279,  15529,
+		 15597,  15441,  15026,  14330,  13341,  12059,  10498,   8683,   6651,   4449,   2132,   -237,
+		 -2593,  -4867,  -6993,  -8906, -10549, -11872, -12835, -13410, -13582, -13347, -12719, -11721,
+		-10392,  -8781,  -6946,  -4952,  -2872,   -779,   1254,   3154,   4856,   6302,   7441,   8235,
+		  8660,   8704,   8367,   7664,   6624,   5284,   3695,   1912,      0,  -1976,  -3950,  -5855,
+		 -7631,  -9224, -10588, -11688, -12498, -13009, -13219, -13142, -12802, -12236, -11486, -10605,
+		 -9647,  -8673,  -7740,  -6905,  -6219,  -5727,  -5464,  -5455,  -5713,  -6240,  -7025,  -8044,
+		 -9262, -10634, -12107, -13621, -15112, -16514, -17762, -18794, -19554, -19996, -20080, -19781,
+		-19085, -17992, -16517, -14685, -12536, -10122,  -7501,  -4743,  -1919,    895,   3623,   6193,
+		  8537,  10595,  12317,  13663,  14608,  15138,  15254,  14969,  14311,  13318,  12038,  10529,
+		  8852,   7075,   5263,   3481,   1791,    248,  -1103,  -2226,  -3097,  -3701,  -4040,  -4126,
+		 -3983,  -3644,  -3153,  -2559,  -1919,  -1289,   -726,   -285,    -17,     36,   -160,   -628,
+		 -1380,  -2416,  -3723,  -5274,  -7035,  -8957, -10986, -13060, -15112, -17075, -18883, -20471,
+		-21781, -22765, -23382, -23605, -23418, -22819, -21821, -20448, -18738, -16741, -14516, -12127,
+		 -9647,  -7150,  -4711,  -2399,   -283,   1579,   3139,   4356,   5206,   5677,   5769,   5497,
+		  4888,   3982,   2826,   1478,      0,
+};
@@ -60,6 +60,14 @@ defined in linker script */
 .word  _sbss
 /* end address for the .bss section. defined in linker script */
 .word  _ebss
+/* start address for the initialization values of the .ccmram section. defined in linker script */
+.word  _siccmram
+/* start and end address for the .ccmram section. defined in linker script */
+.word  _sccmram
+.word  _eccmram
+/* start and end address for the .ccmram_bss section. defined in linker script */
+.word  _sccmbss
+.word  _eccmbss
 /* stack used for SystemInit_ExtMemCtl; always internal RAM used */
 
 /**
@@ -105,6 +113,35 @@ LoopFillZerobss:
   cmp  r2, r3
   bcc  FillZerobss
 
+/* Copy the CCMRAM data initializers and zero fill its bss. A stack placed in CCMRAM only grows
+   down from the top */
+  movs  r1, #0
+  b  LoopCopyCcmInit
+
+CopyCcmInit:
+  ldr  r3, =_siccmram
+  ldr  r3, [r3, r1]
+  str  r3, [r0, r1]
+  adds  r1, r1, #4
+
+LoopCopyCcmInit:
+  ldr  r0, =_sccmram
+  ldr  r3, =_eccmram
+  adds  r2, r0, r1
+  cmp  r2, r3
+  bcc  CopyCcmInit
+  ldr  r2, =_sccmbss
+  b  LoopFillZeroCcmbss
+
+FillZeroCcmbss:
+  movs  r3, #0
+  str  r3, [r2], #4
+
+LoopFillZeroCcmbss:
+  ldr  r3, =_eccmbss
+  cmp  r2, r3
+  bcc  FillZeroCcmbss
+
 /* Call the clock system intitialization function.*/
   bl  SystemInit   
 /* Call static constructors */
@@ -0,0 +1,325 @@
+/*
+ * kinematic_limiter_test.c
+ *
+ * Host test and benchmark of the chassis command limiter (Core/Src/kinematic_limiter.c) with the
+ * limits used in DataLogging.c, run every control tick. Checks the corner cases, prints how long each takes
+ * and the worst acceleration and jerk seen on the axes and wheels, then times the limiter calls.
+ * Not part of the firmware build. From the repository root:
+ *
+ * gcc -O2 -std=gnu11 -DSTM32F429xx -ICore/Inc -IDrivers/CMSIS/Device/ST/STM32F4xx/Include
+ *     -IDrivers/CMSIS/Include Test/kinematic_limiter_test.c Core/Src/kinematic_limiter.c
+ *     Core/Src/speed_limiter.c -lm -o kinematic_limiter_test && ./kinematic_limiter_test
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ray
+ */
+
+#include "kinematic_limiter.h"
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+//Same as main.h, the limiter runs in the control tick at FREQUENCY
+#define BASE_WIDTH		0.5
+#define LIMITER_HZ		1000
+#define TICK_MS			(1000 / LIMITER_HZ)
+//Longest a profile may take to settle
+#define SETTLE_TICKS	(5 * LIMITER_HZ)
+
+//Finite differences average the profile, rounding of the float outputs is all that is allowed over a
+//limit. One float ulp near 1 m/s is 1.2e-4 m/s2 over a 1ms tick, so jerk is taken from accelerations
+//averaged over JERK_STRIDE ticks, where a second difference turns one ulp into 4.8e-3 m/s3
+#define EPS				5e-4
+#define JERK_STRIDE		5
+#define JERK_EPS		1e-2
+
+speedConfig linear_speed_config = {
+		.max_acc = 0.8,
+		.min_acc = -0.4,
+		.max_vel = 1.0,
+		.min_vel = -0.5,
+		.max_jerk = 5.0,
+		.min_jerk = -5.0
+};
+speedConfig angular_speed_config = {
+		.max_acc = 0.8,
+		.min_acc = -0.8,
+		.max_vel = 1.0,
+		.min_vel = -1.0,
+		.max_jerk = 2.5,
+		.min_jerk = -2.5
+};
+static const kinematicConfig kinematic_config = {
+		.base_width = BASE_WIDTH,
+		.max_wheel_vel = 1.2,
+		.max_wheel_acc = 1.0,
+		.linear = &linear_speed_config,
+		.angular = &angular_speed_config
+};
+
+typedef struct{
+	kinematicLimiter_t kl;
+	uint32_t tick;
+	double linear, angular;			/*!< Last output >*/
+	double hist_linear[2 * JERK_STRIDE + 1];	/*!< Outputs of the last ticks, newest first >*/
+	double hist_angular[2 * JERK_STRIDE + 1];
+	int hist_count;
+	double max_a_linear, max_a_angular, max_a_wheel;
+	double max_j_linear, max_j_angular;
+	double max_curvature_error;		/*!< Against the curvature expected, where it is defined >*/
+}sim_t;
+
+static int failures = 0;
+
+static void check(int ok, const char* name, const char* what)
+{
+	if(!ok)
+	{
+		printf("FAIL %s: %s\n", name, what);
+		failures++;
+	}
+}
+
+static void sim_init(sim_t* sim)
+{
+	*sim = (sim_t){ 0 };
+	KL_Init(&sim->kl, &kinematic_config);
+	sim->tick = 1;
+}
+
+static void sim_reset_stats(sim_t* sim)
+{
+	sim->max_a_linear = sim->max_a_angular = sim->max_a_wheel = 0;
+	sim->max_j_linear = sim->max_j_angular = 0;
+	sim->max_curvature_error = 0;
+}
+
+//Run a request until the output settles on it, or for at most max_ticks. Curvature is checked
+//against the given value wherever the chair moves, NAN skips the check. Returns the ticks taken
+static int sim_run(sim_t* sim, float linear, float angular, float curvature, int max_ticks)
+{
+	double dt = TICK_MS / 1000.0;
+	float req_linear = linear, req_angular = angular;
+	KL_LimitRequest(&sim->kl, &req_linear, &req_angular);
+
+	int n;
+	for(n = 0; n < max_ticks; n++)
+	{
+		float out_linear = req_linear, out_angular = req_angular;
+		sim->tick += TICK_MS;
+		KL_Limit(&sim->kl, &out_linear, &out_angular, sim->tick);
+
+		double a_linear = (out_linear - sim->linear) / dt;
+		double a_angular = (out_angular - sim->angular) / dt;
+		double a_turn = a_angular * BASE_WIDTH / 2;
+		sim->max_a_linear = fmax(sim->max_a_linear, fabs(a_linear));
+		sim->max_a_angular = fmax(sim->max_a_angular, fabs(a_angular));
+		sim->max_a_wheel = fmax(sim->max_a_wheel, fmax(fabs(a_linear - a_turn), fabs(a_linear + a_turn)));
+
+		for(int k = 2 * JERK_STRIDE; k > 0; k--)
+		{
+			sim->hist_linear[k] = sim->hist_linear[k - 1];
+			sim->hist_angular[k] = sim->hist_angular[k - 1];
+		}
+		sim->hist_linear[0] = out_linear;
+		sim->hist_angular[0] = out_angular;
+		if(++sim->hist_count > 2 * JERK_STRIDE)
+		{
+			const double* l = sim->hist_linear;
+			const double* r = sim->hist_angular;
+			double stride_dt = JERK_STRIDE * dt;
+			double stride_dt2 = stride_dt * stride_dt;
+			sim->max_j_linear = fmax(sim->max_j_linear,
+					fabs(l[0] - 2 * l[JERK_STRIDE] + l[2 * JERK_STRIDE]) / stride_dt2);
+			sim->max_j_angular = fmax(sim->max_j_angular,
+					fabs(r[0] - 2 * r[JERK_STRIDE] + r[2 * JERK_STRIDE]) / stride_dt2);
+		}
+		if(!isnan(curvature) && fabsf(out_linear) > 1e-3f)
+			sim->max_curvature_error = fmax(sim->max_curvature_error,
+					fabs((double)out_angular / out_linear - curvature));
+
+		sim->linear = out_linear;
+		sim->angular = out_angular;
+		if(out_linear == req_linear && out_angular == req_angular && a_linear == 0 && a_angular == 0)
+			break;
+	}
+	return n;
+}
+
+static void check_limits(const sim_t* sim, const char* name)
+{
+	double max_acc_linear = fmax(linear_speed_config.max_acc, -linear_speed_config.min_acc);
+	double max_acc_angular = fmax(angular_speed_config.max_acc, -angular_speed_config.min_acc);
+	check(sim->max_a_linear <= max_acc_linear + EPS, name, "linear acceleration over its limit");
+	check(sim->max_a_angular <= max_acc_angular + EPS, name, "angular acceleration over its limit");
+	check(sim->max_a_wheel <= kinematic_config.max_wheel_acc + EPS, name, "wheel acceleration over its limit");
+	check(sim->max_j_linear <= linear_speed_config.max_jerk + JERK_EPS, name, "linear jerk over its limit");
+	check(sim->max_j_angular <= angular_speed_config.max_jerk + JERK_EPS, name, "angular jerk over its limit");
+}
+
+static void report(const sim_t* sim, const char* name, int ticks)
+{
+	printf("%-24s %6.3f s  acc lin %5.3f ang %5.3f wheel %5.3f  jerk lin %5.3f ang %5.3f  curv err %.1e\n",
+			name, ticks * TICK_MS / 1000.0, sim->max_a_linear, sim->max_a_angular, sim->max_a_wheel,
+			sim->max_j_linear, sim->max_j_angular, sim->max_curvature_error);
+}
+
+static void test_saturating_request(void)
+{
+	kinematicLimiter_t kl;
+	KL_Init(&kl, &kinematic_config);
+
+	//Outer wheel at 1.5 + 3 * 0.25 = 2.25 m/s
+	float linear = 1.5f, angular = 3.0f;
+	KL_LimitRequest(&kl, &linear, &angular);
+	check(fabsf(angular / linear - 2.0f) < 1e-6f, "saturating", "curvature changed");
+	check(fabsf(linear) + fabsf(angular) * BASE_WIDTH / 2 <= kinematic_config.max_wheel_vel + 1e-6f,
+			"saturating", "wheel over its speed limit");
+	check(linear <= linear_speed_config.max_vel && angular <= angular_speed_config.max_vel,
+			"saturating", "axis over its speed limit");
+
+	//Reversing is limited tighter than going forward
+	linear = -1.0f;
+	angular = 0.4f;
+	KL_LimitRequest(&kl, &linear, &angular);
+	check(fabsf(linear - linear_speed_config.min_vel) < 1e-6f, "reverse", "not held to min_vel");
+	check(fabsf(angular / linear + 0.4f) < 1e-6f, "reverse", "curvature changed");
+
+	//Spin alone is held by the angular limit
+	linear = 0.0f;
+	angular = -2.0f;
+	KL_LimitRequest(&kl, &linear, &angular);
+	check(linear == 0.0f && angular == angular_speed_config.min_vel, "spin request", "not held to min_vel");
+}
+
+static void test_arc_start_stop(void)
+{
+	sim_t sim;
+	sim_init(&sim);
+
+	int ticks = sim_run(&sim, 0.5f, 1.0f, 2.0f, SETTLE_TICKS);
+	check(ticks < SETTLE_TICKS, "arc start", "did not settle");
+	check(sim.max_curvature_error < 1e-5, "arc start", "curvature not held");
+	check_limits(&sim, "arc start");
+	report(&sim, "arc start 0.5 m/s 1 rad/s", ticks);
+
+	sim_reset_stats(&sim);
+	ticks = sim_run(&sim, 0.0f, 0.0f, 2.0f, SETTLE_TICKS);
+	check(ticks < SETTLE_TICKS, "arc stop", "did not settle");
+	check(sim.linear == 0.0f && sim.angular == 0.0f, "arc stop", "did not end at rest");
+	check(sim.max_curvature_error < 1e-5, "arc stop", "curvature not held");
+	check_limits(&sim, "arc stop");
+	report(&sim, "arc stop", ticks);
+}
+
+static void test_arc_speed_change(void)
+{
+	sim_t sim;
+	sim_init(&sim);
+	sim_run(&sim, 0.25f, 0.5f, NAN, SETTLE_TICKS);
+
+	sim_reset_stats(&sim);
+	int ticks = sim_run(&sim, 0.6f, 1.2f, 2.0f, SETTLE_TICKS);
+	check(sim.max_curvature_error < 1e-5, "arc speed up", "curvature not held");
+	check_limits(&sim, "arc speed up");
+	report(&sim, "arc speed up", ticks);
+
+	//Speeding up again before the first profile is over replans with acceleration on the same line
+	sim_reset_stats(&sim);
+	sim_run(&sim, 0.2f, 0.4f, 2.0f, LIMITER_HZ / 10);
+	ticks = sim_run(&sim, 0.4f, 0.8f, 2.0f, SETTLE_TICKS);
+	check(sim.max_curvature_error < 1e-5, "arc replan", "curvature not held");
+	check_limits(&sim, "arc replan");
+	report(&sim, "arc replan mid profile", ticks);
+}
+
+static void test_spin(void)
+{
+	sim_t sim;
+	sim_init(&sim);
+
+	int ticks = sim_run(&sim, 0.0f, 1.0f, NAN, SETTLE_TICKS);
+	check(ticks < SETTLE_TICKS, "spin", "did not settle");
+	check(sim.max_a_linear == 0.0f, "spin", "linear moved");
+	check_limits(&sim, "spin");
+	report(&sim, "spin 1 rad/s", ticks);
+
+	sim_reset_stats(&sim);
+	ticks = sim_run(&sim, 0.0f, -1.0f, NAN, SETTLE_TICKS);
+	check(sim.max_a_linear == 0.0f, "spin reversal", "linear moved");
+	check_limits(&sim, "spin reversal");
+	report(&sim, "spin reversal", ticks);
+}
+
+static void test_curvature_change(void)
+{
+	sim_t sim;
+	sim_init(&sim);
+	sim_run(&sim, 0.5f, 0.0f, NAN, SETTLE_TICKS);
+
+	sim_reset_stats(&sim);
+	int ticks = sim_run(&sim, 0.5f, 1.0f, NAN, SETTLE_TICKS);
+	check(ticks < SETTLE_TICKS, "turn in", "did not settle");
+	check_limits(&sim, "turn in");
+	report(&sim, "straight to arc", ticks);
+
+	//Full reverse while turning, the linear profile brakes at min_acc
+	sim_reset_stats(&sim);
+	ticks = sim_run(&sim, -0.5f, -1.0f, NAN, 2 * SETTLE_TICKS);
+	check(ticks < 2 * SETTLE_TICKS, "reverse", "did not settle");
+	check_limits(&sim, "reverse");
+	report(&sim, "arc to reverse arc", ticks);
+}
+
+static void test_stall(void)
+{
+	sim_t sim;
+	sim_init(&sim);
+	sim_run(&sim, 0.5f, 0.0f, NAN, SETTLE_TICKS);
+
+	//A stalled loop restarts from rest
+	sim.tick += 1000;
+	float linear = 0.5f, angular = 0.0f;
+	KL_Limit(&sim.kl, &linear, &angular, sim.tick);
+	check(linear == 0.0f && angular == 0.0f, "stall", "did not restart from rest");
+}
+
+static void benchmark(void)
+{
+	kinematicLimiter_t kl;
+	KL_Init(&kl, &kinematic_config);
+
+	//New request every call, so every call replans: the worst case on the target
+	const int calls = 2000000;
+	uint32_t seed = 1, tick = 1;
+	float sink = 0;
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for(int n = 0; n < calls; n++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		float linear = (float)(seed >> 16) / 65536.0f * 2.0f - 1.0f;
+		float angular = (float)(seed & 0xFFFF) / 65536.0f * 2.0f - 1.0f;
+		tick += TICK_MS;
+		KL_LimitRequest(&kl, &linear, &angular);
+		KL_Limit(&kl, &linear, &angular, tick);
+		sink += linear + angular;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	double ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / calls;
+	printf("KL_LimitRequest + KL_Limit with a replan: %.1f ns per call on this host (%g)\n", ns, sink);
+}
+
+int main(void)
+{
+	test_saturating_request();
+	test_arc_start_stop();
+	test_arc_speed_change();
+	test_spin();
+	test_curvature_change();
+	test_stall();
+	benchmark();
+
+	printf(failures ? "%d check(s) failed\n" : "All checks passed\n", failures);
+	return failures != 0;
+}
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""Six position accelerometer calibration and mounting levelling over USB (Core/Inc/imu_calib.h).
+
+Walks through the six faces of the board on the bench, then the level capture with the board mounted
+and the chair on level ground, and asks the firmware to store the result in flash. Each capture is
+averaged on the board, keep it still until the reply comes. Single steps can be repeated with --pose.
+
+Usage: python3 ImuCalib.py [--port /dev/ttyACM0] [--pose x_up ... | level | save]
+"""
+
+import argparse
+import struct
+import sys
+
+from TraceDecode import cargo_frames, stm32_crc
+
+TAG_REQUEST = 0x43
+TAG_RESULT = 0x4B
+REQUEST_SAVE = 0x80
+
+# calibPose, in the same order
+POSES = ["x_up", "x_down", "y_up", "y_down", "z_up", "z_down", "level"]
+# calibStatus
+STATUS = ["ok", "wrong pose", "out of range", "save failed"]
+
+PROMPTS = {
+    "x_up": "Board on the bench, sensor x axis pointing up",
+    "x_down": "Sensor x axis pointing down",
+    "y_up": "Sensor y axis pointing up",
+    "y_down": "Sensor y axis pointing down",
+    "z_up": "Sensor z axis pointing up",
+    "z_down": "Sensor z axis pointing down",
+    "level": "Board mounted, chair parked on level ground",
+}
+
+
+def request(ser, value):
+    payload = bytes([TAG_REQUEST, value])
+    body = bytes([len(payload)]) + payload
+    ser.write(b"\xbb\xcc" + body + struct.pack("<I", stm32_crc(body)) + b"\x88")
+
+    def chunks():
+        while True:
+            chunk = ser.read(4096)
+            if not chunk:
+                raise RuntimeError("no reply from %s" % ser.port)
+            yield chunk
+
+    # The data log may share the endpoint, wait for our reply
+    for p in cargo_frames(chunks()):
+        if p[0] == TAG_RESULT and p[1] == value:
+            status = STATUS[p[2]] if p[2] < len(STATUS) else str(p[2])
+            return status, p[3], struct.unpack_from("<fff", p, 4)
+
+
+def step(ser, name):
+    value = REQUEST_SAVE if name == "save" else POSES.index(name)
+    status, done, acc = request(ser, value)
+    if name == "save":
+        print("save: %s" % status)
+    else:
+        print("%-7s %s, accel %8.4f %8.4f %8.4f m/s2, poses done 0x%02x" % (name + ":", status, *acc, done))
+    return status == "ok"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", default="/dev/ttyACM0")
+    parser.add_argument("--pose", choices=POSES + ["save"], help="run a single step")
+    args = parser.parse_args()
+
+    import serial
+    # A capture takes under a second once the board is still, allow for handling it
+    ser = serial.Serial(args.port, baudrate=115200, timeout=30)
+    if args.pose:
+        return 0 if step(ser, args.pose) else 1
+
+    for name in POSES:
+        while True:
+            input("%s, keep it still and press enter" % PROMPTS[name])
+            if step(ser, name):
+                break
+    return 0 if step(ser, "save") else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
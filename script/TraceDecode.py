@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+"""Dump and decode the CCMRAM event trace (Core/Inc/trace.h) over USB.
+
+Requests the live ring or the post-mortem snapshot, collects the cargo frames and prints one line per
+event with its time relative to the newest record. The raw dump can be saved and decoded again later.
+
+Usage: python3 TraceDecode.py [--port /dev/ttyACM0] [--snapshot] [--save dump.bin] [--load dump.bin]
+"""
+
+import argparse
+import struct
+import sys
+
+TAG_REQUEST = 0x51
+TAG_HEADER = 0x48
+TAG_RECORDS = 0x52
+TAG_END = 0x45
+
+# traceEvent, in the same order
+EVENTS = {
+    1: "BOOT",
+    2: "OVERRUN",
+    3: "FAULT",
+    4: "FAULT_CLEAR",
+    5: "PANIC",
+    6: "ERROR",
+    7: "STALL",
+    8: "SOURCE",
+    9: "ESTOP",
+    10: "ENCODER",
+    11: "LINK_RESTART",
+    12: "LINK_CRC",
+    13: "SYNC",
+    14: "DEADLINE",
+}
+
+# supCause
+CAUSES = ["none", "overrun", "hang", "error_handler", "hardfault", "watchdog"]
+# driveSource
+SOURCES = ["idle", "ros", "joystick"]
+# RCC_CSR bits 25..31
+RESET_FLAGS = ["BOR", "PIN", "POR", "SFT", "IWDG", "WWDG", "LPWR"]
+
+
+def stm32_crc(data):
+    """HAL_CRC_Calculate over one 32 bit word per byte, as usb_proxy.c feeds it."""
+    crc = 0xFFFFFFFF
+    for byte in data:
+        crc ^= byte
+        for _ in range(32):
+            crc = ((crc << 1) ^ 0x04C11DB7) & 0xFFFFFFFF if crc & 0x80000000 else (crc << 1) & 0xFFFFFFFF
+    return crc
+
+
+def cargo_frames(stream):
+    """Yield cargo payloads from AA CC len payload crc32 55 frames, skipping anything else."""
+    buf = bytearray()
+    for chunk in stream:
+        buf += chunk
+        while True:
+            start = buf.find(b"\xaa\xcc")
+            if start < 0:
+                del buf[:-1]
+                break
+            del buf[:start]
+            if len(buf) < 3 or len(buf) < buf[2] + 8:
+                break
+            size = buf[2]
+            frame = bytes(buf[:size + 8])
+            crc = struct.unpack_from("<I", frame, size + 3)[0]
+            if frame[-1] != 0x55 or crc != stm32_crc(frame[2:size + 3]):
+                del buf[:1]
+                continue
+            del buf[:size + 8]
+            yield frame[3:size + 3]
+
+
+def collect(payloads):
+    header, records = None, {}
+    for p in payloads:
+        if p[0] == TAG_HEADER:
+            source, cause, flags = p[1], p[2], p[3]
+            head, count, clock, boots = struct.unpack_from("<IIII", p, 4)
+            header = dict(source=source, cause=cause, flags=flags, head=head, count=count,
+                          clock=clock, boots=boots)
+            records = {}
+        elif p[0] == TAG_RECORDS and header is not None:
+            first = p[2] | p[3] << 8
+            for k in range((len(p) - 4) // 16):
+                records[first + k] = struct.unpack_from("<IIII", p, 4 + 16 * k)
+        elif p[0] == TAG_END and header is not None:
+            return header, [records.get(k) for k in range(header["count"])]
+    raise RuntimeError("dump incomplete")
+
+
+def describe(event, a, b):
+    if event == 1:
+        return "reset flags %s, last reset %s, boot %d" % (flag_names(a & 0xFF), cause_name(a >> 8), b)
+    if event in (3, 5):
+        return cause_name(a)
+    if event == 2:
+        return "%d us, %d in a row" % (a, b)
+    if event == 6:
+        return "called from 0x%08x" % a
+    if event == 7:
+        return "%d ms" % a
+    if event == 8:
+        return "%s -> %s" % (name(SOURCES, b), name(SOURCES, a))
+    if event == 9:
+        return "engaged" if a else "released"
+    if event == 10:
+        return "%s wheel, HAL status %d, frame 0x%04x" % ("left" if a == 0 else "right", b & 0xFFFF, b >> 16)
+    if event == 13:
+        return "round trip %d us, offset %d us" % (a, struct.unpack("<i", struct.pack("<I", b))[0])
+    if event == 14:
+        return "task %d finished %d us after release" % (a, b)
+    return "a=%d b=%d" % (a, b)
+
+
+def name(table, value):
+    return table[value] if value < len(table) else str(value)
+
+
+def cause_name(value):
+    return name(CAUSES, value)
+
+
+def flag_names(flags):
+    return "|".join(n for i, n in enumerate(RESET_FLAGS) if flags >> i & 1) or "none"
+
+
+def decode(header, records):
+    head, count, clock = header["head"], header["count"], header["clock"] or 1
+    if header["source"] == 1:
+        print("Post-mortem trace, ended by %s (%s)" % (cause_name(header["cause"]), flag_names(header["flags"])))
+    print("%d records up to #%d, boot %d, %.1f MHz" % (count, head - 1, header["boots"], clock / 1e6))
+
+    # The cycle counter wraps every few tens of seconds and restarts at every boot. Unwrap backwards
+    # from the newest record, events are far denser than a wrap. Times before a boot record are relative
+    # to the last record of that earlier boot
+    events = []
+    for k, rec in enumerate(records):
+        seq = head - count + k
+        if rec is None or rec[1] >> 16 != seq & 0xFFFF:
+            events.append((seq, None))
+        else:
+            events.append((seq, rec))
+    t, boot, later = 0.0, 0, None
+    times = {}
+    for seq, rec in reversed(events):
+        if rec is None:
+            continue
+        if later is not None:
+            if later[1] & 0xFFFF == 1:
+                t, boot = 0.0, boot - 1
+            else:
+                t -= ((later[0] - rec[0]) & 0xFFFFFFFF) / clock
+        times[seq] = (t, boot)
+        later = rec
+    for seq, rec in events:
+        if rec is None:
+            print("#%-8d (overwritten while being written)" % seq)
+            continue
+        event = rec[1] & 0xFFFF
+        t, boot = times[seq]
+        when = "%12.6f s%s" % (t, " (boot %d)" % boot if boot else "")
+        print("#%-8d %s  %-13s %s" % (seq, when, EVENTS.get(event, "EVENT_%d" % event),
+                                      describe(event, rec[2], rec[3])))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", default="/dev/ttyACM0")
+    parser.add_argument("--snapshot", action="store_true", help="dump the post-mortem snapshot")
+    parser.add_argument("--save", help="also write the raw dump to this file")
+    parser.add_argument("--load", help="decode a saved dump instead of reading the port")
+    args = parser.parse_args()
+
+    if args.load:
+        with open(args.load, "rb") as f:
+            raw = f.read()
+        header, records = collect(cargo_frames([raw]))
+    else:
+        import serial
+        ser = serial.Serial(args.port, baudrate=115200, timeout=2)
+        payload = bytes([TAG_REQUEST, 1 if args.snapshot else 0])
+        body = bytes([len(payload)]) + payload
+        ser.write(b"\xbb\xcc" + body + struct.pack("<I", stm32_crc(body)) + b"\x88")
+        raw = bytearray()
+
+        def chunks():
+            while True:
+                chunk = ser.read(4096)
+                if not chunk:
+                    raise RuntimeError("no reply from %s" % args.port)
+                raw.extend(chunk)
+                yield chunk
+        header, records = collect(cargo_frames(chunks()))
+    if args.save:
+        with open(args.save, "wb") as f:
+            f.write(raw)
+    decode(header, records)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
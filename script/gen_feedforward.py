@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""Generate Core/Src/feedforward_tables.c from motor characterisation data.
+
+Measured points are resampled with linear interpolation onto a uniform speed grid
+so the MCU can index the table directly. Points outside the measured range are held
+at the nearest measurement.
+
+Usage: python3 gen_feedforward.py [feedforward.csv] [../Core/Src/feedforward_tables.c]
+"""
+
+import csv
+import os
+import sys
+
+CONTROLLERS = ["by", "cx"]
+WHEELS = ["left", "right"]
+DIRECTIONS = ["fwd", "rev"]
+
+# Grid shared by every table [m/s]
+SPEED_MIN = 0.0
+SPEED_STEP = 0.05
+SPEED_MAX = 1.5
+
+here = os.path.dirname(os.path.abspath(__file__))
+
+
+def read_points(path):
+    points = {}
+    with open(path) as f:
+        rows = csv.DictReader(line for line in f if not line.startswith("#"))
+        for row in rows:
+            key = (row["controller"], row["wheel"], row["direction"])
+            points.setdefault(key, []).append((float(row["speed"]), float(row["gain"])))
+    for key in points:
+        points[key].sort()
+    return points
+
+
+def interpolate(points, speed):
+    if speed <= points[0][0]:
+        return points[0][1]
+    if speed >= points[-1][0]:
+        return points[-1][1]
+    for (x0, y0), (x1, y1) in zip(points, points[1:]):
+        if x0 <= speed <= x1:
+            return y0 + (y1 - y0) * (speed - x0) / (x1 - x0)
+
+
+def main():
+    src = sys.argv[1] if len(sys.argv) > 1 else os.path.join(here, "feedforward.csv")
+    dst = sys.argv[2] if len(sys.argv) > 2 else os.path.join(here, "..", "Core", "Src", "feedforward_tables.c")
+
+    points = read_points(src)
+    size = int(round((SPEED_MAX - SPEED_MIN) / SPEED_STEP)) + 1
+    grid = [SPEED_MIN + i * SPEED_STEP for i in range(size)]
+
+    out = []
+    out.append("/*")
+    out.append(" * feedforward_tables.c")
+    out.append(" *")
+    out.append(" * Generated by script/gen_feedforward.py from script/feedforward.csv, do not edit")
+    out.append(" */")
+    out.append("")
+    out.append('#include "feedforward.h"')
+    out.append("")
+
+    for c in CONTROLLERS:
+        for w in WHEELS:
+            for d in DIRECTIONS:
+                key = (c, w, d)
+                if key not in points:
+                    sys.exit("missing characterisation for %s/%s/%s" % key)
+                values = ["%.4ff" % interpolate(points[key], s) for s in grid]
+                out.append("static const float %s_%s_%s[%d] = {" % (c, w, d, size))
+                for i in range(0, size, 8):
+                    out.append("\t\t" + ", ".join(values[i:i + 8]) + ",")
+                out.append("};")
+                out.append("")
+
+    out.append("const ffTable ff_tables[FF_CONTROLLERS][2][2] = {")
+    for c in CONTROLLERS:
+        out.append("\t\t{")
+        for w in WHEELS:
+            entries = ", ".join("{%.4ff, %.4ff, %d, %s_%s_%s}" % (SPEED_MIN, 1.0 / SPEED_STEP, size, c, w, d)
+                                for d in DIRECTIONS)
+            out.append("\t\t\t\t{%s}," % entries)
+        out.append("\t\t},")
+    out.append("};")
+
+    with open(dst, "w") as f:
+        f.write("\n".join(out) + "\n")
+    print("wrote %d tables of %d points to %s" % (len(CONTROLLERS) * 4, size, dst))
+
+
+if __name__ == "__main__":
+    main()
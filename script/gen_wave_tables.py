@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""Generate the DDS lookup tables in Core/Src/wave_tables.c and Core/Inc/wave_tables.h.
+
+Tables hold one period in Q15 with a guard entry at the end, so the MCU can
+interpolate between entry i and i + 1 without wrapping the index.
+
+Usage: python3 gen_wave_tables.py [table bits] [multisine harmonics...]
+  e.g. python3 gen_wave_tables.py 9 1 2 4 8 16
+"""
+
+import math
+import os
+import sys
+
+here = os.path.dirname(os.path.abspath(__file__))
+
+bits = int(sys.argv[1]) if len(sys.argv) > 1 else 8
+harmonics = [int(h) for h in sys.argv[2:]] or [1, 2, 4, 8]
+size = 1 << bits
+
+
+def q15(x):
+    return max(-32767, min(32767, int(round(x * 32767))))
+
+
+def sine(i):
+    return math.sin(2 * math.pi * i / size)
+
+
+def multisine(i):
+    # Schroeder phases keep the crest factor low, then normalise the peak to full scale
+    n = len(harmonics)
+    return sum(math.sin(2 * math.pi * h * i / size - math.pi * k * (k + 1) / n)
+               for k, h in enumerate(harmonics))
+
+
+peak = max(abs(multisine(i)) for i in range(size))
+
+
+def emit(name, func, scale=1.0):
+    values = [q15(func(i % size) / scale) for i in range(size + 1)]
+    lines = ["const int16_t %s[WAVE_TABLE_SIZE + 1] = {" % name]
+    for i in range(0, len(values), 12):
+        lines.append("\t\t" + ", ".join("%6d" % v for v in values[i:i + 12]) + ",")
+    lines.append("};")
+    return lines
+
+
+header = """/*
+ * wave_tables.h
+ *
+ * Generated by script/gen_wave_tables.py, do not edit
+ */
+
+#ifndef INC_WAVE_TABLES_H_
+#define INC_WAVE_TABLES_H_
+
+#include <stdint.h>
+
+#define WAVE_TABLE_BITS			%d
+#define WAVE_TABLE_SIZE			(1 << WAVE_TABLE_BITS)
+
+//Harmonics in the multisine table: %s
+#define WAVE_MULTISINE_TONES	%d
+
+extern const int16_t wave_sine_table[WAVE_TABLE_SIZE + 1];
+extern const int16_t wave_multisine_table[WAVE_TABLE_SIZE + 1];
+
+#endif /* INC_WAVE_TABLES_H_ */
+""" % (bits, ", ".join(str(h) for h in harmonics), len(harmonics))
+
+source = ["/*",
+          " * wave_tables.c",
+          " *",
+          " * Generated by script/gen_wave_tables.py, do not edit",
+          " */",
+          "",
+          '#include "wave_tables.h"',
+          ""]
+source += emit("wave_sine_table", sine)
+source.append("")
+source += emit("wave_multisine_table", multisine, peak)
+
+with open(os.path.join(here, "..", "Core", "Inc", "wave_tables.h"), "w") as f:
+    f.write(header)
+with open(os.path.join(here, "..", "Core", "Src", "wave_tables.c"), "w") as f:
+    f.write("\n".join(source) + "\n")
+print("wrote %d entry tables, multisine harmonics %s" % (size, harmonics))